@@ -0,0 +1,25 @@
+#pragma once
+
+/*
+ * Replaces the global operator new to count the number of allocations.
+ *
+ * Replacement functions may only be defined once per program, so this must
+ * only be included by a single translation unit per binary.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+inline std::atomic<std::uint64_t> global_alloc_count{0};
+
+void *operator new(std::size_t size) {
+    global_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size > 0 ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
@@ -1,14 +1,43 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <tlx/timestamp.hpp>
 
+#include "alloc_count.hpp"
+#include "latency.hpp"
 #include "perf_count.hpp"
 
+using EventCounts = std::vector<std::pair<std::string, std::uint64_t>>;
+
+//! Detects whether a subject reports internal event counts
+template <class Subject, class = void>
+struct has_event_counts : std::false_type {};
+
+template <class Subject>
+struct has_event_counts<Subject, std::void_t<decltype(Subject::event_counts())>>
+    : std::true_type {};
+
+using Metrics = std::vector<std::pair<std::string, double>>;
+
+//! Detects whether a benchmark reports metrics of its last run
+template <class Benchmark, class = void>
+struct has_metrics : std::false_type {};
+
+template <class Benchmark>
+using metrics_t = decltype(std::declval<const Benchmark &>().metrics());
+
+template <class Benchmark>
+struct has_metrics<Benchmark, std::void_t<metrics_t<Benchmark>>>
+    : std::true_type {};
+
 template <class Benchmark>
 class BenchmarkRunner {
     using Subject = typename Benchmark::subject_type;
@@ -36,9 +65,32 @@ class BenchmarkRunner {
 #endif
     }};
 
+    // The number of allocations during the last benchmark batch
+    std::uint64_t batch_allocs_ = 0;
+
+    // The subject's event counts during the last benchmark batch
+    EventCounts batch_events_;
+
+    // The benchmark's metrics of the last run of the last batch
+    Metrics batch_metrics_;
+
+    // Push and pop latency quantiles over the last benchmark batch. Only
+    // recorded if subjects are wrapped in LatencySampled, see
+    // BM_SAMPLE_LATENCY in benchmark.cpp.in.
+    Metrics batch_latencies_;
+
+    static EventCounts event_counts() {
+        if constexpr (has_event_counts<Subject>::value) {
+            return Subject::event_counts();
+        } else {
+            return {};
+        }
+    }
+
     struct Result {
         const size_t run_size, num_runs;
         const double time;
+        const std::uint64_t allocs;
 
         friend std::ostream &operator<<(std::ostream &os, const Result &r) {
             // clang-format off
@@ -49,7 +101,12 @@ class BenchmarkRunner {
                 << " repeat=" << r.num_runs
                 << std::fixed << std::setprecision(10)
                 << " time_total=" << r.time
-                << " time=" << r.time / static_cast<double>(r.num_runs);
+                << " time=" << r.time / static_cast<double>(r.num_runs)
+                << " throughput="
+                << static_cast<double>(r.run_size * r.num_runs) / r.time
+                << " allocs="
+                << static_cast<double>(r.allocs) /
+                       static_cast<double>(r.num_runs);
             // clang-format on
         }
     };
@@ -60,7 +117,7 @@ class BenchmarkRunner {
         while ((time = run_batch(run_size)) < 1.0) {
             batch_size *= 2;
         }
-        return {run_size, batch_size / run_size, time};
+        return {run_size, batch_size / run_size, time, batch_allocs_};
     }
 
     // Run a batch of benchmark runs of given size and return total time
@@ -68,6 +125,9 @@ class BenchmarkRunner {
         size_t num_runs = batch_size / run_size;
         Benchmark benchmark;
 
+        const auto allocs_before = global_alloc_count.load();
+        Latencies::local() = {};
+        batch_events_ = event_counts();
         double ts1 = tlx::timestamp();
         perf_count_.reset();
         perf_count_.enable();
@@ -76,6 +136,22 @@ class BenchmarkRunner {
         }
         perf_count_.disable();
         double ts2 = tlx::timestamp();
+        batch_allocs_ = global_alloc_count.load() - allocs_before;
+        auto events_after = event_counts();
+        for (size_t i = 0; i < batch_events_.size(); ++i) {
+            auto &count = batch_events_[i].second;
+            count = events_after[i].second - count;
+        }
+
+        if constexpr (has_metrics<Benchmark>::value) {
+            batch_metrics_ = benchmark.metrics();
+        }
+
+        const auto &latencies = Latencies::local();
+        batch_latencies_ = latencies.push.summary("push");
+        for (auto &&entry : latencies.pop.summary("pop")) {
+            batch_latencies_.push_back(std::move(entry));
+        }
 
         return ts2 - ts1;
     }
@@ -101,6 +177,22 @@ public:
                 std::cout << " " << name << "=" << value;
             }
 
+            // report subject events per item, as runs differ in size
+            for (auto &&[name, value] : batch_events_) {
+                std::cout << " " << name << "="
+                          << static_cast<double>(value) /
+                                 static_cast<double>(result.num_runs *
+                                                     result.run_size);
+            }
+
+            for (auto &&[name, value] : batch_metrics_) {
+                std::cout << " " << name << "=" << value;
+            }
+
+            for (auto &&[name, value] : batch_latencies_) {
+                std::cout << " " << name << "=" << value;
+            }
+
             std::cout << std::endl;
         }
     }
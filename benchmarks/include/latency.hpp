@@ -0,0 +1,149 @@
+#pragma once
+
+/*
+ * Per-operation latency histograms for push and pop.
+ *
+ * Subjects wrapped in LatencySampled time each push and pop with the
+ * cheapest clock available (rdtsc on x86) and record the ticks in
+ * log-linear buckets like HdrHistogram's: values are exact below 32 ticks
+ * and within 1/32 of their bucket bound above. Histograms are thread-local,
+ * so concurrent workloads only report the operations of the main thread.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+struct LatencyClock {
+    static std::uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        using namespace std::chrono;
+        return static_cast<std::uint64_t>(
+            steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    //! Nanoseconds per tick, measured once against steady_clock
+    static double ns_per_tick() {
+        static const double ns = [] {
+            using namespace std::chrono;
+            const auto t1 = steady_clock::now();
+            const auto c1 = now();
+            std::this_thread::sleep_for(milliseconds(20));
+            const auto c2 = now();
+            const auto t2 = steady_clock::now();
+            return duration<double, std::nano>(t2 - t1).count() /
+                   static_cast<double>(c2 - c1);
+        }();
+        return ns;
+    }
+};
+
+class LatencyHistogram {
+    static constexpr int kSubBits = 5;
+    static constexpr std::uint64_t kSubBuckets = 1u << kSubBits;
+    static constexpr std::size_t kNumBuckets = 64 * kSubBuckets;
+
+    std::array<std::uint64_t, kNumBuckets> counts_{};
+    std::uint64_t total_ = 0, max_ = 0;
+
+    //! Top kSubBits bits of value, offset by its exponent
+    static std::size_t bucket(std::uint64_t value) {
+        if (value < kSubBuckets) return value;
+        const auto exp = 63 - __builtin_clzll(value) - kSubBits;
+        return static_cast<std::size_t>(exp + 1) * kSubBuckets +
+               (value >> exp) - kSubBuckets;
+    }
+
+    //! The largest value that falls into bucket b
+    static std::uint64_t upper_bound(std::size_t b) {
+        if (b < kSubBuckets) return b;
+        const auto exp = b / kSubBuckets - 1;
+        const auto mantissa = b % kSubBuckets + kSubBuckets;
+        return ((mantissa + 1) << exp) - 1;
+    }
+
+public:
+    void record(std::uint64_t ticks) {
+        ++counts_[bucket(ticks)];
+        ++total_;
+        if (ticks > max_) max_ = ticks;
+    }
+
+    std::uint64_t total() const { return total_; }
+
+    //! The smallest recorded bound below which a fraction q of all values lie
+    std::uint64_t quantile(double q) const {
+        const auto rank = static_cast<std::uint64_t>(
+            q * static_cast<double>(total_ - 1) + 1);
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < kNumBuckets; ++b) {
+            seen += counts_[b];
+            if (seen >= rank) return std::min(upper_bound(b), max_);
+        }
+        return max_;
+    }
+
+    //! p50, p99, p99.9 and max in nanoseconds, prefixed with op_name
+    std::vector<std::pair<std::string, double>>
+    summary(const std::string &op_name) const {
+        if (total_ == 0) return {};
+
+        const auto ns = LatencyClock::ns_per_tick();
+        auto to_ns = [ns](std::uint64_t t) {
+            return static_cast<double>(t) * ns;
+        };
+        return {{op_name + "_p50_ns", to_ns(quantile(0.5))},
+                {op_name + "_p99_ns", to_ns(quantile(0.99))},
+                {op_name + "_p999_ns", to_ns(quantile(0.999))},
+                {op_name + "_max_ns", to_ns(max_)}};
+    }
+};
+
+struct Latencies {
+    LatencyHistogram push, pop;
+
+    static Latencies &local() {
+        static thread_local Latencies latencies;
+        return latencies;
+    }
+};
+
+//! Records the ticks between its construction and destruction
+class LatencyTimer {
+    LatencyHistogram &histogram_;
+    const std::uint64_t start_;
+
+public:
+    explicit LatencyTimer(LatencyHistogram &histogram)
+        : histogram_(histogram), start_(LatencyClock::now()) {}
+
+    ~LatencyTimer() { histogram_.record(LatencyClock::now() - start_); }
+};
+
+//! Times every push and pop of Base
+template <class Base>
+struct LatencySampled : Base {
+    template <class... Args>
+    decltype(auto) push(Args &&...args) {
+        LatencyTimer timer(Latencies::local().push);
+        return Base::push(std::forward<Args>(args)...);
+    }
+
+    decltype(auto) pop() {
+        LatencyTimer timer(Latencies::local().pop);
+        return Base::pop();
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+/*
+ * Reports structural events of S³Q subjects to the benchmark runner.
+ *
+ * The queues only count events if BM_COLLECT_STATS is defined, since their
+ * Cfg then sets kCollectStats, see s3q::Stats. Each queue adds its counts to
+ * a global total when it is destroyed, i.e. at the end of each run.
+ */
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef BM_COLLECT_STATS
+inline constexpr bool kBmCollectStats = true;
+#else
+inline constexpr bool kBmCollectStats = false;
+#endif
+
+template <class Queue>
+class S3QStatsReported : public Queue {
+public:
+    S3QStatsReported() = default;
+    S3QStatsReported(const S3QStatsReported &) = default;
+    S3QStatsReported(S3QStatsReported &&) = default;
+    S3QStatsReported &operator=(const S3QStatsReported &) = default;
+    S3QStatsReported &operator=(S3QStatsReported &&) = default;
+
+    ~S3QStatsReported() {
+        if constexpr (kBmCollectStats) {
+            for (auto &&level : this->stats().levels) {
+                classifier_builds() += level.classifier_builds;
+            }
+        }
+    }
+
+    static auto event_counts() {
+        std::vector<std::pair<std::string, std::uint64_t>> counts;
+        if constexpr (kBmCollectStats) {
+            counts.emplace_back("classifier_builds", classifier_builds());
+        }
+        return counts;
+    }
+
+private:
+    static std::uint64_t &classifier_builds() {
+        static std::uint64_t count = 0;
+        return count;
+    }
+};
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <s3q/s3q.hpp>
+
+#include "../s3q_stats.hpp"
+
 #include <cstddef>
 
-template <int logK, int logM>
+template <int logK, int logM, int minBufArity = 2>
 class S3Q {
     template <typename T>
     struct Cfg : s3q::DefaultCfg {
@@ -11,9 +14,11 @@ class S3Q {
         static constexpr std::ptrdiff_t kBufBaseSize =
             (1l << logM) / sizeof(Item);
         static constexpr int kLogMaxDegree = logK;
+        static constexpr bool kCollectStats = kBmCollectStats;
+        static constexpr int kMinBufArity = minBufArity;
     };
 
 public:
     template <typename T>
-    class type : public s3q::PriorityQueue<Cfg<T>> {};
+    class type : public S3QStatsReported<s3q::PriorityQueue<Cfg<T>>> {};
 };
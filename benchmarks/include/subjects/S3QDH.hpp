@@ -0,0 +1,54 @@
+#pragma once
+
+#include <s3q/s3q.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+//! Like S3QBH, but with the D-ary min-buffer heap
+template <int Arity>
+class S3QDH {
+public:
+    template <typename T>
+    class type {
+        struct BaseCfg : s3q::DefaultCfg {
+            using Item = T;
+        };
+        using Cfg = s3q::detail::ExtendedCfg<BaseCfg>;
+        using Heap = s3q::detail::DAryHeap<Cfg, Arity>;
+
+        std::vector<T> data;
+
+    public:
+        //! Allocates an empty heap.
+        explicit type() {
+            // add sentinel
+            data.resize(1);
+            Cfg::getKey(data[0]) = Cfg::KeyRange::inf();
+        }
+
+        // Disable {copy,move} ctor and assignment operator
+        type(type const &) = delete;
+        type &operator=(type const &) = delete;
+
+        std::size_t size() const noexcept { return Heap::size(data); }
+        bool empty() const noexcept { return size() == 0; }
+        T top() const noexcept { return Heap::top(data); }
+
+        //! Inserts a new item.
+        void push(const T &item) {
+            // Assert that we do not insert sentinel keys
+            assert(Cfg::KeyRange::contains(Cfg::getKey(item)));
+
+            data.push_back(item);
+            Heap::push(data);
+        }
+
+        //! Removes the top item.
+        void pop() {
+            Heap::pop(data);
+            data.pop_back();
+        }
+    };
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <s3q/external.hpp>
+#include <s3q/s3q.hpp>
+
+#include <sys/resource.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! Stores levels from extLevel on in files below $S3Q_EXTERNAL_DIR or /tmp
+template <int logK, int logM, int extLevel>
+class S3QExternal {
+    template <typename T>
+    struct Cfg : s3q::DefaultCfg {
+        using Item = T;
+        static constexpr std::ptrdiff_t kBufBaseSize =
+            (1l << logM) / sizeof(Item);
+        static constexpr int kLogMaxDegree = logK;
+        static constexpr int kExternalLevel = extLevel;
+
+        static const char *externalDirectory() {
+            static const char *dir = std::getenv("S3Q_EXTERNAL_DIR");
+            return dir ? dir : "/tmp";
+        }
+    };
+
+public:
+    template <typename T>
+    class type : public s3q::PriorityQueue<Cfg<T>> {
+    public:
+        static auto event_counts() {
+            auto &stats = s3q::detail::MappedStorage::stats();
+            rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+
+            // rusage counts blocks of 512 bytes
+            auto bytes = [](long blocks) {
+                return static_cast<std::uint64_t>(blocks) * 512;
+            };
+            return std::vector<std::pair<std::string, std::uint64_t>>{
+                {"buffer_bytes", stats.buffer_bytes.load()},
+                {"io_read_bytes", bytes(usage.ru_inblock)},
+                {"io_write_bytes", bytes(usage.ru_oublock)}};
+        }
+    };
+};
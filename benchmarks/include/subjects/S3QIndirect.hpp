@@ -0,0 +1,28 @@
+#pragma once
+
+#include <s3q/s3q.hpp>
+
+#include "../s3q_stats.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+template <int logK, int logM>
+class S3QIndirect {
+    template <typename T>
+    struct Cfg : s3q::DefaultCfg {
+        using Item = T;
+        // Buffers only hold entries made of a key and a payload index
+        using Entry = std::pair<decltype(T::key), std::uint32_t>;
+        static constexpr std::ptrdiff_t kBufBaseSize =
+            (1l << logM) / sizeof(Entry);
+        static constexpr int kLogMaxDegree = logK;
+        static constexpr bool kCollectStats = kBmCollectStats;
+    };
+
+public:
+    template <typename T>
+    class type
+        : public S3QStatsReported<s3q::IndirectPriorityQueue<Cfg<T>>> {};
+};
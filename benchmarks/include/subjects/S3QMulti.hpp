@@ -0,0 +1,19 @@
+#pragma once
+
+#include <s3q/s3q.hpp>
+#include <cstddef>
+
+template <int logK, int logM>
+class S3QMulti {
+    template <typename T>
+    struct Cfg : s3q::DefaultCfg {
+        using Item = T;
+        static constexpr std::ptrdiff_t kBufBaseSize =
+            (1l << logM) / sizeof(Item);
+        static constexpr int kLogMaxDegree = logK;
+    };
+
+public:
+    template <typename T>
+    class type : public s3q::MultiQueue<Cfg<T>> {};
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <s3q/s3q.hpp>
+#include <cstddef>
+
+template <int logK, int logM, int numThreads>
+class S3QParallel {
+    template <typename T>
+    struct Cfg : s3q::DefaultCfg {
+        using Item = T;
+        static constexpr std::ptrdiff_t kBufBaseSize =
+            (1l << logM) / sizeof(Item);
+        static constexpr int kLogMaxDegree = logK;
+
+        static s3q::ThreadPool *threadPool() {
+            static s3q::ThreadPool pool(numThreads);
+            return &pool;
+        }
+    };
+
+public:
+    template <typename T>
+    class type : public s3q::PriorityQueue<Cfg<T>> {};
+};
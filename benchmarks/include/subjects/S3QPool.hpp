@@ -0,0 +1,24 @@
+#pragma once
+
+#include <s3q/s3q.hpp>
+
+#include "../s3q_stats.hpp"
+
+#include <cstddef>
+
+template <int logK, int logM>
+class S3QPool {
+    template <typename T>
+    struct Cfg : s3q::DefaultCfg {
+        using Item = T;
+        using Allocator = s3q::PoolAllocator<Item>;
+        static constexpr std::ptrdiff_t kBufBaseSize =
+            (1l << logM) / sizeof(Item);
+        static constexpr int kLogMaxDegree = logK;
+        static constexpr bool kCollectStats = kBmCollectStats;
+    };
+
+public:
+    template <typename T>
+    class type : public S3QStatsReported<s3q::PriorityQueue<Cfg<T>>> {};
+};
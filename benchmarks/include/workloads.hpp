@@ -1,10 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <limits>
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <tlx/die.hpp>
 
@@ -28,6 +38,22 @@ struct Item {
 using IntItem = Item<std::uint32_t>;
 using FloatItem = Item<float>;
 
+//! An item of Bytes bytes with a 64-bit key and an opaque payload
+template <std::size_t Bytes>
+struct SizedItem {
+    static_assert(Bytes > sizeof(std::uint64_t));
+
+    std::uint64_t key = 0;
+    char payload[Bytes - sizeof(std::uint64_t)] = {};
+
+    constexpr bool operator<(const SizedItem &b) const noexcept {
+        return key < b.key;
+    }
+    constexpr bool operator>(const SizedItem &b) const noexcept {
+        return key > b.key;
+    }
+};
+
 template <class ItemType>
 struct ItemHelper {
     using key_type = decltype(ItemType::key);
@@ -40,6 +66,124 @@ struct ItemHelper {
     }
 };
 
+//! Detects whether a heap supports pushing whole ranges of items at once
+template <class HeapType, class Rng, class = void>
+struct has_push_range : std::false_type {};
+
+template <class HeapType, class Rng>
+using push_range_t = decltype(std::declval<HeapType &>().push_range(
+    std::declval<const Rng &>()));
+
+template <class HeapType, class Rng>
+struct has_push_range<HeapType, Rng, std::void_t<push_range_t<HeapType, Rng>>>
+    : std::true_type {};
+
+//! Pushes all items using push_range if available and push otherwise
+template <class HeapType, class Rng>
+void push_all(HeapType &heap, const Rng &items) {
+    if constexpr (has_push_range<HeapType, Rng>::value) {
+        heap.push_range(items);
+    } else {
+        for (const auto &item : items) heap.push(item);
+    }
+}
+
+//! Detects whether a heap supports popping several items at once
+template <class HeapType, class OutputIt, class = void>
+struct has_pop_n : std::false_type {};
+
+template <class HeapType, class OutputIt>
+using pop_n_t = decltype(std::declval<HeapType &>().pop_n(
+    std::size_t(), std::declval<OutputIt>()));
+
+template <class HeapType, class OutputIt>
+struct has_pop_n<HeapType, OutputIt, std::void_t<pop_n_t<HeapType, OutputIt>>>
+    : std::true_type {};
+
+//! Pops k items into out using pop_n if Bulk is set and available
+template <bool Bulk, class HeapType, class OutputIt>
+OutputIt pop_k(HeapType &heap, std::size_t k, OutputIt out) {
+    if constexpr (Bulk && has_pop_n<HeapType, OutputIt>::value) {
+        return heap.pop_n(k, out);
+    } else {
+        for (; k > 0; --k) {
+            *out++ = heap.top();
+            heap.pop();
+        }
+        return out;
+    }
+}
+
+//! Detects whether a heap supports relaxed popping of whole buckets
+template <class HeapType, class = void>
+struct has_pop_bucket : std::false_type {};
+
+template <class HeapType>
+struct has_pop_bucket<
+    HeapType, std::void_t<decltype(std::declval<HeapType &>().pop_bucket())>>
+    : std::true_type {};
+
+//! Detects whether a heap can be built from a whole range of items at once
+template <class HeapType, class Rng, class = void>
+struct has_assign : std::false_type {};
+
+template <class HeapType, class Rng>
+struct has_assign<HeapType, Rng,
+                  std::void_t<decltype(std::declval<HeapType &>().assign(
+                      std::declval<const Rng &>()))>> : std::true_type {};
+
+//! Detects whether a heap supports decrease-key via handles
+template <class HeapType, class = void>
+struct has_decrease_key : std::false_type {};
+
+template <class HeapType>
+struct has_decrease_key<
+    HeapType,
+    std::void_t<decltype(std::declval<HeapType &>().decrease_key(
+        std::declval<HeapType &>().push(std::declval<IntItem>()),
+        IntItem().key))>> : std::true_type {};
+
+//! Detects whether a heap supports melding with another one
+template <class HeapType, class = void>
+struct has_merge : std::false_type {};
+
+template <class HeapType>
+using merge_t =
+    decltype(std::declval<HeapType &>().merge(std::declval<HeapType &&>()));
+
+template <class HeapType>
+struct has_merge<HeapType, std::void_t<merge_t<HeapType>>> : std::true_type {};
+
+//! Detects whether a heap is concurrent, i.e. supports try_pop
+template <class HeapType, class = void>
+struct has_try_pop : std::false_type {};
+
+template <class HeapType>
+struct has_try_pop<HeapType,
+                   std::void_t<decltype(std::declval<HeapType &>().try_pop(
+                       std::declval<IntItem &>()))>> : std::true_type {};
+
+//! Detects whether a heap hands out producer handles for pushing
+template <class HeapType, class = void>
+struct has_producer : std::false_type {};
+
+template <class HeapType>
+struct has_producer<
+    HeapType, std::void_t<decltype(std::declval<HeapType &>().producer())>>
+    : std::true_type {};
+
+//! Detects whether a heap can save its state to a stream and load it again
+template <class HeapType, class = void>
+struct has_save : std::false_type {};
+
+template <class HeapType>
+struct has_save<HeapType,
+                std::void_t<decltype(std::declval<const HeapType &>().save(
+                                std::declval<std::ostream &>())),
+                            decltype(std::declval<HeapType &>().load(
+                                std::declval<std::istream &>()))>>
+    : std::true_type {};
+
 template <typename HeapType>
 class BaseDriver {
 protected:
@@ -55,6 +199,68 @@ public:
     void pop() { heap_.pop(); }
 };
 
+//! Shares a heap between threads
+//! Sequential heaps are guarded by a mutex, concurrent ones are used directly
+template <typename HeapType>
+class ConcurrentDriver {
+    HeapType heap_;
+    std::mutex mutex_;
+
+    //! Pushes through the driver for heaps without producer handles
+    class Producer {
+        ConcurrentDriver &driver_;
+
+    public:
+        explicit Producer(ConcurrentDriver &driver) : driver_(driver) {}
+
+        template <class ItemType>
+        void push(const ItemType &item) {
+            driver_.push(item);
+        }
+
+        void flush() {}
+    };
+
+public:
+    using heap_type = HeapType;
+    static constexpr bool is_concurrent = has_try_pop<HeapType>::value;
+
+    //! Only exact if no other thread is using the heap
+    size_t size() const { return heap_.size(); }
+
+    template <class ItemType>
+    void push(const ItemType &item) {
+        if constexpr (is_concurrent) {
+            heap_.push(item);
+        } else {
+            std::lock_guard<std::mutex> lock(mutex_);
+            heap_.push(item);
+        }
+    }
+
+    template <class ItemType>
+    bool try_pop(ItemType &item) {
+        if constexpr (is_concurrent) {
+            return heap_.try_pop(item);
+        } else {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (heap_.empty()) return false;
+            item = heap_.top();
+            heap_.pop();
+            return true;
+        }
+    }
+
+    //! A handle for one thread that only pushes
+    auto producer() {
+        if constexpr (has_producer<HeapType>::value) {
+            return heap_.producer();
+        } else {
+            return Producer(*this);
+        }
+    }
+};
+
 template <template <class> class HeapTemplate, class ItemType = IntItem>
 class RandomDriver : public BaseDriver<HeapTemplate<ItemType>> {
     using item_helper = ItemHelper<ItemType>;
@@ -78,11 +284,19 @@ template <template <class> class HeapTemplate, class ItemType = FloatItem>
 class MonotoneDriver : public BaseDriver<HeapTemplate<ItemType>> {
     using item_helper = ItemHelper<ItemType>;
     using key_type = typename item_helper::key_type;
-    key_type max_deleted_key{0};
-    std::exponential_distribution<key_type> incr_dist_;
+    static constexpr bool integral = std::is_integral_v<key_type>;
+
+    // Integer keys grow by 1024 on average, so keys are mostly distinct
+    using incr_dist_type =
+        std::conditional_t<integral, std::geometric_distribution<key_type>,
+                           std::exponential_distribution<key_type>>;
+
+    // Zero is the sentinel key of queues with unsigned keys
+    key_type max_deleted_key = integral ? 1 : 0;
+    incr_dist_type incr_dist_{integral ? 1.0 / 1024 : 1.0};
 
 public:
-    static auto name() { return "monotone"; }
+    static auto name() { return integral ? "monotone_int" : "monotone"; }
 
     void push() {
         auto key = max_deleted_key + incr_dist_(this->rand_engine_);
@@ -95,6 +309,9 @@ public:
     }
 };
 
+template <template <class> class HeapTemplate>
+using MonotoneIntDriver = MonotoneDriver<HeapTemplate, IntItem>;
+
 template <unsigned S, template <template <typename> class> class Driver>
 struct Wiggle {
     static constexpr unsigned wiggle_count = S;
@@ -138,3 +355,919 @@ struct Wiggle {
         }
     };
 };
+
+//! Inserts random items in batches of size B, then pops all of them
+template <std::size_t B>
+struct BatchedIngest {
+    static constexpr std::size_t batch_size = B;
+
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return "batched_ingest_" + std::to_string(batch_size);
+        }
+
+        void run(size_t items) {
+            subject_type heap;
+            std::minstd_rand rand_engine(42);
+            std::vector<IntItem> batch;
+            batch.reserve(batch_size);
+
+            // Fill heap batch by batch
+            for (size_t i = 0; i < items; i += batch_size) {
+                batch.clear();
+                for (size_t j = i; j < std::min(items, i + batch_size); j++) {
+                    auto key = key_type(rand_engine());
+                    batch.push_back(item_helper::make_item(key));
+                }
+                push_all(heap, batch);
+            }
+
+            die_unless(heap.size() == items);
+
+            // Empty heap
+            for (size_t i = 0; i < items; i++) {
+                heap.pop();
+            }
+
+            die_unless(heap.empty());
+        }
+    };
+};
+
+//! Inserts random items, then pops them in batches of size B
+template <std::size_t B, bool Bulk = true>
+struct BatchedDrain {
+    static constexpr std::size_t batch_size = B;
+
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return "batched_drain_" + std::to_string(batch_size) +
+                   (Bulk ? "" : "_scalar");
+        }
+
+        void run(size_t items) {
+            subject_type heap;
+            std::minstd_rand rand_engine(42);
+            std::vector<IntItem> batch(batch_size);
+
+            // Fill heap
+            for (size_t i = 0; i < items; i++) {
+                auto key = key_type(rand_engine());
+                heap.push(item_helper::make_item(key));
+            }
+
+            die_unless(heap.size() == items);
+
+            // Empty heap batch by batch
+            while (!heap.empty()) {
+                auto k = std::min(heap.size(), batch_size);
+                auto end = pop_k<Bulk>(heap, k, batch.begin());
+                die_unless(std::is_sorted(batch.begin(), end));
+            }
+
+            die_unless(heap.empty());
+        }
+    };
+};
+
+//! Inserts random items, then pops whole buckets if Relaxed is set
+template <bool Relaxed>
+struct BucketDrain {
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return std::string("bucket_drain_") +
+                   (Relaxed ? "relaxed" : "strict");
+        }
+
+        void run(size_t items) {
+            subject_type heap;
+            std::minstd_rand rand_engine(42);
+
+            // Fill heap
+            for (size_t i = 0; i < items; i++) {
+                auto key = key_type(rand_engine());
+                heap.push(item_helper::make_item(key));
+            }
+
+            die_unless(heap.size() == items);
+
+            // Empty heap
+            if constexpr (Relaxed && has_pop_bucket<subject_type>::value) {
+                while (!heap.empty()) {
+                    auto bucket = heap.pop_bucket();
+                    die_unless(heap.empty() || bucket.sup < heap.top().key);
+                }
+            } else {
+                for (size_t i = 0; i < items; i++) {
+                    heap.pop();
+                }
+            }
+
+            die_unless(heap.empty());
+        }
+    };
+};
+
+//! Builds a heap from random items, either at once or by repeated push
+template <bool Bulk>
+struct BuildFromRange {
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return std::string("build_") + (Bulk ? "bulk" : "push");
+        }
+
+        void run(size_t items) {
+            subject_type heap;
+            std::minstd_rand rand_engine(42);
+            std::vector<IntItem> input;
+            input.reserve(items);
+
+            for (size_t i = 0; i < items; i++) {
+                auto key = key_type(rand_engine());
+                input.push_back(item_helper::make_item(key));
+            }
+
+            // Build heap
+            using Input = decltype(input);
+            if constexpr (Bulk && has_assign<subject_type, Input>::value) {
+                heap.assign(input);
+            } else {
+                for (const auto &item : input) heap.push(item);
+            }
+
+            die_unless(heap.size() == items);
+        }
+    };
+};
+
+//! A weighted directed graph in compressed sparse row format
+struct Graph {
+    using node_type = decltype(IntItem::value);
+    using weight_type = decltype(IntItem::key);
+
+    struct Edge {
+        node_type target;
+        weight_type weight;
+    };
+
+    // Out-edges of node u are edges[first_edge[u]..first_edge[u+1])
+    std::vector<std::size_t> first_edge;
+    std::vector<Edge> edges;
+
+    size_t num_nodes() const {
+        return first_edge.empty() ? 0 : first_edge.size() - 1;
+    }
+
+    auto out_edges(node_type u) const {
+        const auto first = edges.begin() + std::ptrdiff_t(first_edge[u]);
+        const auto last = edges.begin() + std::ptrdiff_t(first_edge[u + 1]);
+        return std::make_pair(first, last);
+    }
+};
+
+//! Every node has Degree out-edges to random nodes, weighing 1..MaxWeight
+template <unsigned Degree, unsigned MaxWeight>
+struct RandomGraph {
+    static auto name() {
+        return "random_" + std::to_string(Degree) + "_" +
+               std::to_string(MaxWeight);
+    }
+
+    static void generate(Graph &g, size_t num_nodes) {
+        using node_type = Graph::node_type;
+        std::minstd_rand rand_engine(42);
+        std::uniform_int_distribution<node_type> node_dist(
+            0, static_cast<node_type>(num_nodes - 1));
+        std::uniform_int_distribution<Graph::weight_type> weight_dist(
+            1, MaxWeight);
+
+        g.first_edge.resize(num_nodes + 1);
+        for (size_t u = 0; u <= num_nodes; ++u) g.first_edge[u] = u * Degree;
+        g.edges.resize(num_nodes * Degree);
+        for (auto &e : g.edges) {
+            e = {node_dist(rand_engine), weight_dist(rand_engine)};
+        }
+    }
+};
+
+//! A square grid in which nodes are connected to their four neighbours by
+//! edges weighing 1..MaxWeight. Small weights yield many equal distances.
+template <unsigned MaxWeight>
+struct GridGraph {
+    static auto name() { return "grid_" + std::to_string(MaxWeight); }
+
+    static void generate(Graph &g, size_t num_nodes) {
+        using node_type = Graph::node_type;
+        std::minstd_rand rand_engine(42);
+        std::uniform_int_distribution<Graph::weight_type> weight_dist(
+            1, MaxWeight);
+
+        // the last row may be incomplete
+        const auto width = std::max<size_t>(
+            1, static_cast<size_t>(std::sqrt(static_cast<double>(num_nodes))));
+
+        g.first_edge.assign(1, 0);
+        g.edges.clear();
+        auto add_edge = [&](size_t v) {
+            const auto target = static_cast<node_type>(v);
+            g.edges.push_back({target, weight_dist(rand_engine)});
+        };
+        for (size_t u = 0; u < num_nodes; ++u) {
+            if (u % width > 0) add_edge(u - 1);
+            if (u % width + 1 < width && u + 1 < num_nodes) add_edge(u + 1);
+            if (u >= width) add_edge(u - width);
+            if (u + width < num_nodes) add_edge(u + width);
+            g.first_edge.push_back(g.edges.size());
+        }
+    }
+};
+
+//! Runs Dijkstra's algorithm from node 0 of a graph with `items` nodes
+//! Uses decrease-key if supported and re-insertion of duplicates otherwise
+template <class GraphGenerator>
+struct ShortestPath {
+    template <template <typename> class HeapType>
+    class type {
+        using key_type = Graph::weight_type;
+
+        Graph graph_;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return "shortest_path_" + GraphGenerator::name() +
+                   (has_decrease_key<subject_type>::value ? "_decrease_key"
+                                                          : "_reinsert");
+        }
+
+        void run(size_t items) {
+            if (graph_.num_nodes() != items) {
+                GraphGenerator::generate(graph_, items);
+            }
+
+            subject_type heap;
+            constexpr auto unreached = std::numeric_limits<key_type>::max();
+            std::vector<key_type> dist(items, unreached);
+
+            // Keys must not be zero, so the source gets a distance of one
+            dist[0] = 1;
+            heap.push(IntItem(dist[0], 0));
+
+            // handles for decrease-key; only used if supported
+            using PushResult = decltype(heap.push(IntItem()));
+            using Handle = std::conditional_t<std::is_void_v<PushResult>,
+                                              char, PushResult>;
+            std::vector<Handle> handles;
+            if constexpr (has_decrease_key<subject_type>::value) {
+                handles.resize(items);
+            }
+
+            size_t num_settled = 0;
+            while (!heap.empty()) {
+                const auto item = heap.top();
+                heap.pop();
+
+                // Skip outdated duplicates
+                if (item.key > dist[item.value]) continue;
+                ++num_settled;
+
+                auto [first, last] = graph_.out_edges(item.value);
+                for (auto e = first; e != last; ++e) {
+                    const auto new_dist = item.key + e->weight;
+                    const auto old_dist = dist[e->target];
+                    if (new_dist >= old_dist) continue;
+
+                    dist[e->target] = new_dist;
+                    const IntItem new_item(new_dist, e->target);
+                    if constexpr (has_decrease_key<subject_type>::value) {
+                        if (old_dist != unreached) {
+                            heap.decrease_key(handles[e->target], new_dist);
+                        } else {
+                            handles[e->target] = heap.push(new_item);
+                        }
+                    } else {
+                        heap.push(new_item);
+                    }
+                }
+            }
+
+            die_unless(num_settled > 0 && num_settled <= items);
+        }
+    };
+};
+
+//! Increments of the hold model, all with a mean of about one
+struct ExponentialIncrement {
+    static auto name() { return "exponential"; }
+
+    std::exponential_distribution<float> dist_{1.0f};
+
+    template <class Urbg>
+    float operator()(Urbg &urbg) {
+        return dist_(urbg);
+    }
+};
+
+struct UniformIncrement {
+    static auto name() { return "uniform"; }
+
+    std::uniform_real_distribution<float> dist_{0.0f, 2.0f};
+
+    template <class Urbg>
+    float operator()(Urbg &urbg) {
+        return dist_(urbg);
+    }
+};
+
+//! Mostly tiny increments with rare large ones
+struct BimodalIncrement {
+    static auto name() { return "bimodal"; }
+
+    std::bernoulli_distribution large_{0.1};
+    std::uniform_real_distribution<float> small_dist_{0.0f, 0.2f};
+    std::uniform_real_distribution<float> large_dist_{0.0f, 18.0f};
+
+    template <class Urbg>
+    float operator()(Urbg &urbg) {
+        return large_(urbg) ? large_dist_(urbg) : small_dist_(urbg);
+    }
+};
+
+//! The classic hold model: fills the heap with items, then repeatedly pops
+//! the minimum t and pushes t plus a random increment
+template <class Increment>
+struct Hold {
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<FloatItem>;
+
+    public:
+        using subject_type = HeapType<FloatItem>;
+
+        static auto name() { return std::string("hold_") + Increment::name(); }
+
+        void run(size_t items) {
+            subject_type heap;
+            std::minstd_rand rand_engine(42);
+            Increment increment;
+
+            for (size_t i = 0; i < items; i++) {
+                heap.push(item_helper::make_item(increment(rand_engine)));
+            }
+
+            // Hold operations
+            for (size_t i = 0; i < items; i++) {
+                const auto now = heap.top().key;
+                heap.pop();
+                heap.push(item_helper::make_item(now + increment(rand_engine)));
+            }
+
+            die_unless(heap.size() == items);
+        }
+    };
+};
+
+//! Merges K sorted runs of random keys, holding one item per run in the heap
+template <unsigned K>
+struct KWayMerge {
+    template <template <typename> class HeapType>
+    class type {
+        using key_type = decltype(IntItem::key);
+        using run_idx = decltype(IntItem::value);
+
+        size_t num_items_ = 0;
+        std::vector<std::vector<key_type>> runs_;
+
+        void generate_runs(size_t items) {
+            if (items == num_items_) return;
+
+            std::minstd_rand rand_engine(42);
+            num_items_ = items;
+            runs_.assign(K, {});
+            for (size_t i = 0; i < items; i++) {
+                runs_[i % K].push_back(key_type(rand_engine()));
+            }
+            for (auto &r : runs_) std::sort(r.begin(), r.end());
+        }
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() { return "kway_merge_" + std::to_string(K); }
+
+        void run(size_t items) {
+            generate_runs(items);
+
+            subject_type heap;
+            std::vector<size_t> next(K, 0);
+            for (run_idx r = 0; r < K; ++r) {
+                if (runs_[r].empty()) continue;
+                heap.push(IntItem(runs_[r][0], r));
+                next[r] = 1;
+            }
+
+            size_t num_merged = 0;
+            key_type last_key = 0;
+            while (!heap.empty()) {
+                const auto item = heap.top();
+                heap.pop();
+                die_unless(item.key >= last_key);
+                last_key = item.key;
+                ++num_merged;
+
+                const auto &r = runs_[item.value];
+                if (auto &i = next[item.value]; i < r.size()) {
+                    heap.push(IntItem(r[i++], item.value));
+                }
+            }
+
+            die_unless(num_merged == items);
+        }
+    };
+};
+
+//! Time-forward processing of a random DAG with `items` nodes
+//! Every node sends a message to Degree successors within the next 1024
+//! nodes. Messages are keyed by their target, so the heap holds many equal
+//! keys and a node pops all of its messages before sending its own.
+template <unsigned Degree>
+struct TimeForward {
+    template <template <typename> class HeapType>
+    class type {
+        using node_type = decltype(IntItem::key);
+        static constexpr node_type window = 1024;
+
+        size_t num_nodes_ = 0;
+        std::vector<node_type> successors_;
+
+        void generate_dag(size_t num_nodes) {
+            if (num_nodes == num_nodes_) return;
+
+            std::minstd_rand rand_engine(42);
+            std::uniform_int_distribution<node_type> offset_dist(1, window);
+            num_nodes_ = num_nodes;
+            successors_.resize(num_nodes * Degree);
+            for (auto &v : successors_) v = offset_dist(rand_engine);
+        }
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return "time_forward_" + std::to_string(Degree);
+        }
+
+        void run(size_t items) {
+            generate_dag(items);
+
+            // Keys must not be zero, so nodes are numbered from one
+            subject_type heap;
+            const auto n = static_cast<node_type>(items);
+            for (node_type u = 1; u <= n; ++u) {
+                auto value = decltype(IntItem::value)(u);
+                while (!heap.empty() && heap.top().key == u) {
+                    value += heap.top().value;
+                    heap.pop();
+                }
+                die_unless(heap.empty() || heap.top().key > u);
+
+                const auto first = successors_.begin() +
+                                   std::ptrdiff_t((u - 1) * size_t(Degree));
+                for (auto v = first; v != first + Degree; ++v) {
+                    if (*v <= n - u) heap.push(IntItem(u + *v, value));
+                }
+            }
+
+            die_unless(heap.empty());
+        }
+    };
+};
+
+//! Pushes random items with only 2^LogKeys distinct keys, then pops them.
+//! Even with 2^10 keys, the largest runs put 2^17 items on each key, far more
+//! than a bucket of the first levels holds, so S3Q relies on its equality
+//! buckets there.
+template <unsigned LogKeys>
+struct Duplicates {
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return "duplicates_" + std::to_string(1ul << LogKeys);
+        }
+
+        void run(size_t items) {
+            subject_type heap;
+            std::minstd_rand rand_engine(42);
+            constexpr key_type mask = (key_type(1) << LogKeys) - 1;
+
+            // Fill heap, keys must not be zero
+            for (size_t i = 0; i < items; i++) {
+                auto key = key_type(1 + (rand_engine() & mask));
+                heap.push(item_helper::make_item(key));
+            }
+
+            die_unless(heap.size() == items);
+
+            // Empty heap
+            key_type last_key = 0;
+            for (size_t i = 0; i < items; i++) {
+                die_unless(heap.top().key >= last_key);
+                last_key = heap.top().key;
+                heap.pop();
+            }
+
+            die_unless(heap.empty());
+        }
+    };
+};
+
+//! Fills two heaps with random items, merges them and empties the result
+//! Falls back to moving items one by one if merge is not supported
+struct Merge {
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() { return "merge"; }
+
+        void run(size_t items) {
+            subject_type heap, other;
+            std::minstd_rand rand_engine(42);
+
+            // Fill both heaps
+            for (size_t i = 0; i < items; i++) {
+                auto key = key_type(rand_engine());
+                (i % 2 ? other : heap).push(item_helper::make_item(key));
+            }
+
+            // Merge other into heap
+            if constexpr (has_merge<subject_type>::value) {
+                heap.merge(std::move(other));
+            } else {
+                for (; !other.empty(); other.pop()) heap.push(other.top());
+            }
+
+            die_unless(other.empty());
+            die_unless(heap.size() == items);
+
+            // Empty heap
+            for (size_t i = 0; i < items; i++) {
+                heap.pop();
+            }
+
+            die_unless(heap.empty());
+        }
+    };
+};
+
+//! Shares a heap of random items between Threads threads, each of which
+//! repeatedly pops an item and pushes a new random one
+//! The rank error of all pops is computed by replaying the operations in the
+//! order of their timestamps, outside of the timed run
+template <unsigned Threads>
+struct Concurrent {
+    static constexpr unsigned num_threads = Threads;
+
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+        using clock = std::chrono::steady_clock;
+
+        // A push or pop as observed by one of the threads
+        struct Op {
+            clock::time_point time;
+            key_type key;
+            bool is_pop;
+        };
+
+        std::vector<key_type> initial_keys_;
+        std::vector<std::vector<Op>> logs_;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return "concurrent_" + std::to_string(num_threads) + "t";
+        }
+
+        void run(size_t items) {
+            ConcurrentDriver<subject_type> heap;
+            std::minstd_rand rand_engine(42);
+
+            // Fill heap
+            initial_keys_.clear();
+            for (size_t i = 0; i < items; i++) {
+                auto key = key_type(rand_engine());
+                initial_keys_.push_back(key);
+                heap.push(item_helper::make_item(key));
+            }
+
+            // Pops are stamped after and pushes before they take effect, so
+            // the replay never pops an item before it was pushed
+            const auto ops_per_thread = items / num_threads;
+            logs_.assign(num_threads, {});
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < num_threads; t++) {
+                threads.emplace_back([&, t] {
+                    std::minstd_rand thread_engine(43 + t);
+                    auto &log = logs_[t];
+                    log.reserve(2 * ops_per_thread);
+
+                    IntItem item;
+                    for (size_t i = 0; i < ops_per_thread; i++) {
+                        die_unless(heap.try_pop(item));
+                        log.push_back({clock::now(), item.key, true});
+
+                        auto key = key_type(thread_engine());
+                        log.push_back({clock::now(), key, false});
+                        heap.push(item_helper::make_item(key));
+                    }
+                });
+            }
+            for (auto &thread : threads) thread.join();
+
+            die_unless(heap.size() == items);
+        }
+
+        //! The mean and maximum rank error of all pops of the last run
+        std::vector<std::pair<std::string, double>> metrics() const {
+            std::vector<Op> ops;
+            for (auto &log : logs_) {
+                std::copy(log.begin(), log.end(), std::back_inserter(ops));
+            }
+            std::stable_sort(ops.begin(), ops.end(),
+                             [](auto &a, auto &b) { return a.time < b.time; });
+
+            // Count the present items per key in a Fenwick tree
+            std::vector<key_type> keys = initial_keys_;
+            for (auto &op : ops) keys.push_back(op.key);
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+            std::vector<std::int64_t> tree(keys.size() + 1);
+            auto index_of = [&](key_type key) {
+                auto it = std::lower_bound(keys.begin(), keys.end(), key);
+                return static_cast<size_t>(it - keys.begin()) + 1;
+            };
+            auto add = [&](key_type key, std::int64_t delta) {
+                for (auto i = index_of(key); i < tree.size(); i += i & -i) {
+                    tree[i] += delta;
+                }
+            };
+            auto num_smaller = [&](key_type key) {
+                std::int64_t n = 0;
+                for (auto i = index_of(key) - 1; i > 0; i -= i & -i) {
+                    n += tree[i];
+                }
+                return n;
+            };
+
+            for (auto key : initial_keys_) add(key, 1);
+
+            std::int64_t sum = 0, max = 0, num_pops = 0;
+            for (auto &op : ops) {
+                if (op.is_pop) {
+                    const auto rank_error = num_smaller(op.key);
+                    sum += rank_error;
+                    max = std::max(max, rank_error);
+                    num_pops++;
+                }
+                add(op.key, op.is_pop ? -1 : 1);
+            }
+
+            const auto mean = num_pops ? static_cast<double>(sum) /
+                                             static_cast<double>(num_pops)
+                                       : 0.0;
+            return {{"rank_error_mean", mean},
+                    {"rank_error_max", static_cast<double>(max)}};
+        }
+    };
+};
+
+//! Producer threads push random items while the main thread pops all of
+//! them as they arrive
+//! Reports the mean time producers take per push and the consumer per pop
+template <unsigned Producers>
+struct ProducerConsumer {
+    static constexpr unsigned num_producers = Producers;
+
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+        using clock = std::chrono::steady_clock;
+        using seconds = std::chrono::duration<double>;
+
+        size_t num_items_ = 0;
+        std::vector<double> push_times_;
+        double pop_time_ = 0;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return "producer_consumer_" + std::to_string(num_producers);
+        }
+
+        void run(size_t items) {
+            ConcurrentDriver<subject_type> heap;
+            const auto items_per_producer = items / num_producers;
+            num_items_ = items_per_producer * num_producers;
+            push_times_.assign(num_producers, 0.0);
+
+            std::vector<std::thread> producers;
+            for (unsigned t = 0; t < num_producers; t++) {
+                producers.emplace_back([&, t] {
+                    std::minstd_rand rand_engine(42 + t);
+                    auto producer = heap.producer();
+
+                    const auto start = clock::now();
+                    for (size_t i = 0; i < items_per_producer; i++) {
+                        auto key = key_type(rand_engine());
+                        producer.push(item_helper::make_item(key));
+                    }
+                    producer.flush();
+                    push_times_[t] = seconds(clock::now() - start).count();
+                });
+            }
+
+            // Only successful pops count towards the pop time
+            pop_time_ = 0;
+            IntItem item;
+            for (size_t popped = 0; popped < num_items_;) {
+                const auto start = clock::now();
+                if (!heap.try_pop(item)) continue;
+                pop_time_ += seconds(clock::now() - start).count();
+                popped++;
+            }
+
+            for (auto &producer : producers) producer.join();
+            die_unless(heap.size() == 0);
+        }
+
+        //! Push and pop latencies of the last run in nanoseconds
+        std::vector<std::pair<std::string, double>> metrics() const {
+            if (num_items_ == 0) return {};
+
+            double push_time = 0;
+            for (auto time : push_times_) push_time += time;
+
+            const auto n = static_cast<double>(num_items_);
+            return {{"push_ns", 1e9 * push_time / n},
+                    {"pop_ns", 1e9 * pop_time_ / n}};
+        }
+    };
+};
+
+//! Fills a heap, saves it to memory and restores it into a new heap
+//! Heaps without save and load are drained into a vector and re-pushed,
+//! which is what a restart costs without them
+//! Reports the time per item to save and to load
+struct SaveLoad {
+    template <template <typename> class HeapType>
+    class type {
+        using item_helper = ItemHelper<IntItem>;
+        using key_type = typename item_helper::key_type;
+        using clock = std::chrono::steady_clock;
+        using seconds = std::chrono::duration<double>;
+
+        size_t num_items_ = 0;
+        double save_time_ = 0, load_time_ = 0;
+
+    public:
+        using subject_type = HeapType<IntItem>;
+
+        static auto name() {
+            return std::string("save_load_") +
+                   (has_save<subject_type>::value ? "binary" : "drain");
+        }
+
+        void run(size_t items) {
+            subject_type heap, restored;
+            std::minstd_rand rand_engine(42);
+
+            // Fill heap
+            for (size_t i = 0; i < items; i++) {
+                auto key = key_type(rand_engine());
+                heap.push(item_helper::make_item(key));
+            }
+
+            num_items_ = items;
+            const auto start = clock::now();
+            if constexpr (has_save<subject_type>::value) {
+                std::stringstream stream;
+                heap.save(stream);
+                const auto saved = clock::now();
+                restored.load(stream);
+                die_unless(stream);
+
+                save_time_ = seconds(saved - start).count();
+                load_time_ = seconds(clock::now() - saved).count();
+            } else {
+                std::vector<IntItem> saved_items;
+                saved_items.reserve(items);
+                for (; !heap.empty(); heap.pop()) {
+                    saved_items.push_back(heap.top());
+                }
+                const auto saved = clock::now();
+                for (const auto &item : saved_items) restored.push(item);
+
+                save_time_ = seconds(saved - start).count();
+                load_time_ = seconds(clock::now() - saved).count();
+            }
+
+            die_unless(restored.size() == items);
+        }
+
+        //! Save and load times of the last run in nanoseconds per item
+        std::vector<std::pair<std::string, double>> metrics() const {
+            if (num_items_ == 0) return {};
+
+            const auto n = static_cast<double>(num_items_);
+            return {{"save_ns", 1e9 * save_time_ / n},
+                    {"load_ns", 1e9 * load_time_ / n}};
+        }
+    };
+};
+
+//! Inserts random items of Bytes bytes, then pops all of them
+template <std::size_t Bytes>
+struct ItemSize {
+    template <template <typename> class HeapType>
+    class type {
+        using item_type = SizedItem<Bytes>;
+
+    public:
+        using subject_type = HeapType<item_type>;
+
+        static auto name() { return "item_size_" + std::to_string(Bytes); }
+
+        void run(size_t items) {
+            subject_type heap;
+            std::mt19937_64 rand_engine(42);
+
+            // Fill heap, keeping the key in the payload to check it later
+            for (size_t i = 0; i < items; i++) {
+                item_type item;
+                item.key = rand_engine() >> 1;
+                std::fill(std::begin(item.payload), std::end(item.payload),
+                          static_cast<char>(item.key));
+                heap.push(item);
+            }
+
+            die_unless(heap.size() == items);
+
+            // Empty heap
+            std::uint64_t last_key = 0;
+            for (size_t i = 0; i < items; i++) {
+                const auto item = heap.top();
+                die_unless(item.key >= last_key);
+                die_unless(item.payload[0] == static_cast<char>(item.key));
+                last_key = item.key;
+                heap.pop();
+            }
+
+            die_unless(heap.empty());
+        }
+    };
+};
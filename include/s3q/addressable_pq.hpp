@@ -0,0 +1,182 @@
+#pragma once
+
+#include "config.hpp"
+#include "pq.hpp"
+#include "stats.hpp"
+#include "util.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace s3q::detail {
+
+/**
+ * A PriorityQueue whose items can be addressed by the handles push returns.
+ *
+ * Decreasing a key or erasing an item is lazy: the affected queue entry just
+ * becomes stale and is skipped once it reaches the top. As soon as stale
+ * entries outnumber live ones, the queue is rebuilt from the live ones.
+ */
+template <class Cfg>
+class AddressablePriorityQueue {
+public:
+    using Item = typename Cfg::Item;
+    using Key = typename Cfg::Key;
+    using Handle = std::uint32_t;
+
+    std::size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    bool contains(Handle h) const { return h < slots_.size() && live(h); }
+
+    const Item &get(Handle h) const {
+        assert(contains(h));
+        return slots_[h].item;
+    }
+
+    const Item &top() const {
+        assert(!empty());
+        return get(queue_.top().handle);
+    }
+
+    Handle push(Item item) {
+        assert(Cfg::KeyRange::contains(Cfg::getKey(item)));
+        const auto h = acquireHandle();
+        slots_[h].item = std::move(item);
+        queue_.push(entryOf(h));
+        ++size_;
+        return h;
+    }
+
+    Item pop() {
+        assert(!empty());
+        const auto h = queue_.pop().handle;
+        auto item = std::move(slots_[h].item);
+        releaseHandle(h);
+        --size_;
+        skipStale();
+        return item;
+    }
+
+    // Sets the key of the item addressed by h to k, which must not be larger
+    void decrease_key(Handle h, Key k) {
+        assert(contains(h));
+        assert(Cfg::KeyRange::contains(k));
+        assert(!Cfg::compare(Cfg::getKey(get(h)), k));
+
+        auto &slot = slots_[h];
+        Cfg::getKey(slot.item) = k;
+        ++slot.version;
+        queue_.push(entryOf(h));
+        ++num_stale_;
+
+        skipStale();
+        compactIfNeeded();
+    }
+
+    void erase(Handle h) {
+        assert(contains(h));
+        releaseHandle(h);
+        --size_;
+        ++num_stale_;
+
+        skipStale();
+        compactIfNeeded();
+    }
+
+    Stats stats() const { return queue_.stats(); }
+
+private:
+    // A queue entry is stale iff its version differs from that of its slot
+    struct Entry {
+        Key key;
+        Handle handle;
+        std::uint32_t version;
+    };
+
+    struct Slot {
+        Item item;
+        std::uint32_t version = 0;
+        bool live = false;
+    };
+
+    struct EntryCfg : Cfg {
+        using Item = Entry;
+    };
+
+    using Queue = PriorityQueue<ExtendedCfg<EntryCfg>>;
+
+    bool live(Handle h) const { return slots_[h].live; }
+
+    bool stale(const Entry &e) const {
+        return slots_[e.handle].version != e.version;
+    }
+
+    Entry entryOf(Handle h) const {
+        const auto &slot = slots_[h];
+        return {Cfg::getKey(slot.item), h, slot.version};
+    }
+
+    Handle acquireHandle() {
+        Handle h;
+        if (free_handles_.empty()) {
+            h = num_cast<Handle>(slots_.size());
+            slots_.emplace_back();
+        } else {
+            h = free_handles_.back();
+            free_handles_.pop_back();
+        }
+
+        assert(!live(h));
+        slots_[h].live = true;
+        return h;
+    }
+
+    void releaseHandle(Handle h) {
+        auto &slot = slots_[h];
+        slot.live = false;
+        ++slot.version;
+        free_handles_.push_back(h);
+    }
+
+    // Ensures that the queue's top entry is live
+    void skipStale() {
+        while (!queue_.empty() && stale(queue_.top())) {
+            queue_.pop();
+            --num_stale_;
+        }
+    }
+
+    // Rebuilds the queue from live entries if stale entries dominate
+    void compactIfNeeded() {
+        if (num_stale_ <= size_ || ssize(queue_) < Cfg::kBufBaseSize) return;
+
+        S3Q_TRACE << "event=compact size=" << size_ << " stale=" << num_stale_
+                  << "\n";
+
+        std::vector<Entry> entries;
+        entries.reserve(size_);
+        for (Handle h = 0; h < slots_.size(); ++h) {
+            if (live(h)) entries.push_back(entryOf(h));
+        }
+
+        queue_.assign(std::move(entries));
+        num_stale_ = 0;
+    }
+
+    // The number of live items
+    std::size_t size_ = 0;
+
+    // The number of stale entries in queue_
+    std::size_t num_stale_ = 0;
+
+    std::vector<Slot> slots_;
+    std::vector<Handle> free_handles_;
+    Queue queue_;
+};
+
+} // namespace s3q::detail
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "util.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace s3q {
+
+namespace detail {
+
+/**
+ * A thread-local cache of memory blocks with power-of-two sizes.
+ *
+ * Freed blocks are kept in a free list per size class, so that bucket
+ * buffers which are constantly created and destroyed by splits, joins and
+ * refills can reuse each other's storage. Only blocks of up to
+ * kMaxBlockSize bytes are pooled, and at most kMaxCachedBytes of them are
+ * kept, so large buffers of coarse levels go straight back to the system.
+ */
+class BlockPool {
+public:
+    struct Stats {
+        // Requests served from a free list and from operator new
+        std::uint64_t hits = 0, misses = 0;
+    };
+
+    // Each size class keeps at most this many free blocks
+    static constexpr std::size_t kMaxFreeBlocks = 64;
+
+    // Larger blocks are neither rounded up nor cached
+    static constexpr std::size_t kMaxBlockSize = std::size_t{1} << 22;
+
+    // Bound on the bytes of all free blocks of a pool
+    static constexpr std::size_t kMaxCachedBytes = std::size_t{1} << 26;
+
+    // The pool of the calling thread, or null if it has been destroyed
+    // already, as happens to static queues that outlive the pool
+    static BlockPool *local() {
+        static thread_local BlockPool pool;
+        return destroyed() ? nullptr : &pool;
+    }
+
+    // Reserve free lists up front, so that deallocate never allocates
+    BlockPool() {
+        for (auto &free_list : free_lists_) free_list.reserve(kMaxFreeBlocks);
+    }
+    BlockPool(const BlockPool &) = delete;
+    BlockPool &operator=(const BlockPool &) = delete;
+
+    ~BlockPool() {
+        release();
+        destroyed() = true;
+    }
+
+    void *allocate(std::size_t bytes) {
+        if (bytes > kMaxBlockSize) return ::operator new(bytes);
+
+        const auto cls = sizeClass(bytes);
+        auto &free_list = free_lists_[cls];
+        if (free_list.empty()) {
+            ++stats_.misses;
+            return ::operator new(classSize(cls));
+        }
+
+        ++stats_.hits;
+        auto *block = free_list.back();
+        free_list.pop_back();
+        cached_bytes_ -= classSize(cls);
+        return block;
+    }
+
+    void deallocate(void *block, std::size_t bytes) {
+        if (bytes > kMaxBlockSize) return ::operator delete(block);
+
+        const auto cls = sizeClass(bytes);
+        auto &free_list = free_lists_[cls];
+        if (free_list.size() < kMaxFreeBlocks &&
+            cached_bytes_ + classSize(cls) <= kMaxCachedBytes) {
+            free_list.push_back(block);
+            cached_bytes_ += classSize(cls);
+        } else {
+            ::operator delete(block);
+        }
+    }
+
+    // Returns all cached blocks to the system
+    void release() {
+        for (auto &free_list : free_lists_) {
+            for (auto *block : free_list) ::operator delete(block);
+            free_list.clear();
+        }
+        cached_bytes_ = 0;
+    }
+
+    const Stats &stats() const { return stats_; }
+
+private:
+    static constexpr std::size_t kNumClasses = 23;
+    static_assert(kMaxBlockSize <= std::size_t{1} << (kNumClasses - 1));
+
+    static std::size_t sizeClass(std::size_t bytes) {
+        return bytes <= 1 ? 0 : num_cast<std::size_t>(log2_ceil(bytes));
+    }
+
+    static std::size_t classSize(std::size_t cls) {
+        return std::size_t{1} << cls;
+    }
+
+    static bool &destroyed() {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    Stats stats_;
+    std::size_t cached_bytes_ = 0;
+    std::array<std::vector<void *>, kNumClasses> free_lists_;
+};
+
+} // namespace detail
+
+/**
+ * Stateless allocator that recycles storage through detail::BlockPool.
+ *
+ * Set `using Allocator = s3q::PoolAllocator<Item>;` in your Cfg to use it
+ * for all item buffers of a queue.
+ */
+template <class T>
+struct PoolAllocator {
+    using value_type = T;
+
+    // Pooled blocks come from plain operator new
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "PoolAllocator does not support over-aligned types");
+
+    PoolAllocator() noexcept = default;
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        auto *pool = detail::BlockPool::local();
+        if (!pool) return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(pool->allocate(n * sizeof(T)));
+    }
+
+    // Falls back to operator delete for queues outliving the thread's pool
+    void deallocate(T *p, std::size_t n) noexcept {
+        auto *pool = detail::BlockPool::local();
+        if (!pool) return ::operator delete(p);
+        pool->deallocate(p, n * sizeof(T));
+    }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U> &) const noexcept {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const PoolAllocator<U> &) const noexcept {
+        return false;
+    }
+};
+
+} // namespace s3q
@@ -2,25 +2,38 @@
 
 #include "level.hpp"
 #include "sampling.hpp"
+#include "serialize.hpp"
+#include "stats.hpp"
 #include "util.hpp"
 
+#include <range/v3/algorithm/min.hpp>
+#include <range/v3/core.hpp>
+#include <range/v3/view/move.hpp>
 #include <range/v3/view/transform.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <deque>
+#include <istream>
 #include <iterator>
+#include <ostream>
 #include <utility>
+#include <vector>
 
 namespace s3q::detail {
 
 template <class Cfg>
 class BatchedPriorityQueue {
     using Level = ::s3q::detail::Level<Cfg>;
-    using SplitterSampler = ::s3q::detail::SplitterSampler<>;
+    using SplitterSampler =
+        ::s3q::detail::SplitterSampler<typename Cfg::Compare>;
 
 public:
     using Bucket = typename Level::Bucket;
+    using Buffer = typename Level::Buffer;
+    using Splitters = typename Level::Splitters;
 
     std::size_t size() const { return size_; }
 
@@ -37,11 +50,11 @@ public:
         traceState("insert:after");
     }
 
-    void insertMin(Bucket &&b) {
+    void insertMin(Bucket &&b, Splitters splitters = {}) {
         size_ += b.buf.size();
 
         auto first_lvl = levels_.begin();
-        first_lvl->insertMin(std::move(b));
+        first_lvl->insertMin(std::move(b), std::move(splitters));
 
         // flush any overflowing buffers starting from first_lvl
         handleMaxBufOverflowFrom(first_lvl);
@@ -49,6 +62,121 @@ public:
         traceState("insertMin:after");
     }
 
+    /**
+     * Replaces the contents of this queue by the given items.
+     *
+     * Levels are filled from finest to coarsest, each one taking the
+     * smallest of the remaining items. This is linear in the number of items
+     * per level instead of cascading flushes through all levels.
+     */
+    void assign(Buffer &&items) {
+        size_ = items.size();
+
+        truncateLevels(0);
+        levels_.emplace_back(sampler_);
+        auto rest = levels_.back().assign(std::move(items));
+
+        while (!rest.empty()) {
+            levels_.emplace_back(sampler_, levels_.back());
+            rest = levels_.back().assign(std::move(rest));
+        }
+
+        // flush any overflowing buffers starting from first level
+        handleMaxBufOverflowFrom(levels_.begin());
+
+        traceState("assign:after");
+    }
+
+    /**
+     * Moves all items of other into this queue.
+     *
+     * Other's buckets are reused as batches. Each one is inserted into the
+     * coarsest of our levels that may hold all of its items, so its items do
+     * not have to be classified by all finer levels first.
+     * @return items from buckets that were too small to form a batch
+     */
+    Buffer merge(BatchedPriorityQueue &&other) {
+        assert(&other != this);
+        Buffer carry;
+
+        for (auto &lvl : other.levels_) {
+            for (auto &b : lvl.takeBuckets()) {
+                if (ssize(b.buf) >= levels_.front().minBatchSize()) {
+                    insertBatch(std::move(b.buf));
+                    continue;
+                }
+
+                // collect small buckets until they form a batch
+                append(carry, rv::move(b.buf));
+                if (ssize(carry) >= levels_.front().minBatchSize()) {
+                    insertBatch(std::exchange(carry, {}));
+                }
+            }
+        }
+
+        other.truncateLevels(0);
+        other.levels_.emplace_back(other.sampler_);
+        other.size_ = 0;
+
+        traceState("merge:after");
+
+        return carry;
+    }
+
+    void save(std::ostream &os) const {
+        writeValue(os, static_cast<std::uint64_t>(size_));
+        writeValue(os, static_cast<std::uint64_t>(levels_.size()));
+        for (const auto &lvl : levels_) lvl.save(os);
+    }
+
+    /**
+     * Replaces the contents of this queue by the levels written by save.
+     *
+     * Every level's sups must be in order and not less than the last
+     * splitters of the finer levels, and the total size must match. On
+     * failure, this queue is left empty.
+     */
+    bool load(std::istream &is) {
+        truncateLevels(0);
+        levels_.emplace_back(sampler_);
+        size_ = 0;
+
+        std::uint64_t size, num_levels;
+        auto floor = Cfg::KeyRange::inf();
+        bool ok = readValue(is, size) && readValue(is, num_levels) &&
+                  num_levels > 0 && num_levels <= kMaxLevels &&
+                  levels_.back().load(is, floor);
+        for (std::uint64_t i = 1; ok && i < num_levels; ++i) {
+            const auto &finer = levels_.back();
+            floor = std::max(floor, finer.lastSplitter(), Cfg::compare);
+            levels_.emplace_back(sampler_, finer);
+            ok = levels_.back().load(is, floor);
+        }
+
+        std::uint64_t total = 0;
+        for (const auto &lvl : levels_) total += lvl.size();
+        ok = ok && total == size;
+
+        if (!ok) {
+            truncateLevels(0);
+            levels_.emplace_back(sampler_);
+            return false;
+        }
+
+        size_ = static_cast<std::size_t>(size);
+        traceState("load:after");
+        return true;
+    }
+
+    Stats stats() const {
+        Stats result{levels_added_, dropped_stats_};
+        result.levels.resize(std::max(result.levels.size(), levels_.size()));
+        for (std::size_t i = 0; i < levels_.size(); ++i) {
+            result.levels[i] += levels_[i].stats();
+        }
+        return result;
+    }
+
     Bucket delMin() {
         // remove & save min-buf from finest level
         auto min_bucket = levels_[0].delMin();
@@ -56,6 +184,12 @@ public:
         // refill any levels whose degree underflows (if possible)
         handleDegreeUnderflow();
 
+        // skip empty guards in front of equality buckets
+        while (min_bucket.buf.empty() && size_ > 0) {
+            min_bucket = levels_[0].delMin();
+            handleDegreeUnderflow();
+        }
+
         size_ -= min_bucket.buf.size();
 
         traceState("delMin:after");
@@ -68,6 +202,49 @@ private:
     // PERF: use vector w/ stack allocation & static max-size?
     using Levels = std::deque<Level>;
 
+    // Bucket sizes grow geometrically, so no queue gets this deep
+    static constexpr std::uint64_t kMaxLevels = 64;
+
+    /**
+     * Inserts a batch of items into the coarsest level that may hold them.
+     *
+     * Items of a level are larger than the last splitter of any finer level,
+     * so the batch may go into a level iff its minimum exceeds the last
+     * splitters of all finer levels.
+     */
+    void insertBatch(Buffer &&items) {
+        const auto n = ssize(items);
+        assert(n >= levels_.front().minBatchSize());
+        size_ += items.size();
+
+        const auto min_key =
+            ranges::min(items | rv::transform(Cfg::getKey), Cfg::compare);
+        auto lvl_idx = std::ptrdiff_t{0};
+        for (; lvl_idx + 1 < ssize(levels_); ++lvl_idx) {
+            const auto lvl = levels_.begin() + lvl_idx;
+            if (!Cfg::compare(lvl->lastSplitter(), min_key)) break;
+            if (n < std::next(lvl)->minBatchSize()) break;
+        }
+
+        S3Q_TRACE << "event=insert_batch size=" << n << " lvl=" << lvl_idx
+                  << "\n";
+
+        // Insert in as few chunks of legal size as possible. Adding a level
+        // invalidates our iterators, so we have to look up lvl every time.
+        const auto lvl = [this, lvl_idx] { return levels_.begin() + lvl_idx; };
+        const auto max_chunk_size = lvl()->maxBatchSize();
+        const auto num_chunks = (n + max_chunk_size - 1) / max_chunk_size;
+        const auto chunk_size = (n + num_chunks - 1) / num_chunks;
+        for (auto first = items.begin(); first != items.end();) {
+            const auto last = first + std::min(chunk_size, items.end() - first);
+            lvl()->insert(ranges::subrange(first, last));
+            first = last;
+
+            // flush any overflowing buffers starting from lvl
+            handleMaxBufOverflowFrom(lvl());
+        }
+    }
+
     /**
      * Flushes all overflowing max-buffers starting from begin.
      * @param begin a level that just had items inserted into it
@@ -93,6 +270,7 @@ private:
             assert(lvl->degree() > Cfg::kMaxDegree - Cfg::kSplitFactor);
 
             // Add new level and flush max-buf into it
+            if constexpr (Cfg::kCollectStats) ++levels_added_;
             levels_.emplace_back(sampler_, *lvl);
             lvl->flushMaxBufInto(levels_.back());
         }
@@ -125,7 +303,7 @@ private:
 
         // if the last level has been emptied, remove it and return
         if (lvl == last_lvl && lvl->degree() == 0) {
-            return levels_.pop_back();
+            return truncateLevels(levels_.size() - 1);
         }
 
         // lvl might have been pushed to during flushMaxBufInto(lvl)
@@ -134,6 +312,21 @@ private:
         handleMaxBufOverflowFrom(lvl);
     }
 
+    // Removes all levels from the n-th one onwards, keeping their stats
+    void truncateLevels(std::size_t n) {
+        if constexpr (Cfg::kCollectStats) {
+            if (dropped_stats_.size() < levels_.size()) {
+                dropped_stats_.resize(levels_.size());
+            }
+            for (auto i = n; i < levels_.size(); ++i) {
+                auto lvl_stats = levels_[i].stats();
+                lvl_stats.bytes_allocated = 0;
+                dropped_stats_[i] += lvl_stats;
+            }
+        }
+        while (levels_.size() > n) levels_.pop_back();
+    }
+
     void traceState(const char *event_name) {
         S3Q_TRACE << "event=BatchedPriorityQueue::" << event_name
                   << " size=" << size_ << " levels="
@@ -147,6 +340,11 @@ private:
 
     SplitterSampler sampler_;
 
+    // Only maintained if Cfg collects stats. The counts of removed levels
+    // are kept in dropped_stats_.
+    std::uint64_t levels_added_ = 0;
+    std::vector<LevelStats> dropped_stats_;
+
     // sorted from finest to coarsest (ascending order of elements)
     Levels levels_{Level(sampler_)};
 };
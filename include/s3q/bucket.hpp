@@ -9,11 +9,16 @@ struct Bucket {
     using Key = typename Cfg::Key;
     using Item = typename Cfg::Item;
     using KeyRange = typename Cfg::KeyRange;
-    using Buffer = std::vector<Item>;
+    using Buffer = std::vector<Item, typename Cfg::Allocator>;
 
     Key sup = KeyRange::sup();
     Buffer buf;
 
+    // All items have key sup and the predecessor's sup is the next smaller
+    // key, so no other key is classified into this bucket. Such a bucket is
+    // never split, however large it grows.
+    bool all_equal = false;
+
     Bucket() {}
     Bucket(Key sup) : sup(sup) {}
 
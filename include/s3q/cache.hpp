@@ -0,0 +1,50 @@
+#pragma once
+
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+// Cache sizes of the target machine in bytes. Unless the build reads them from
+// sysfs (see S3Q_DETECT_CACHES in CMakeLists.txt), we assume a common x86 core.
+// That yields 32 KiB buffers and a degree of 64.
+#ifndef S3Q_L1D_CACHE_SIZE
+#define S3Q_L1D_CACHE_SIZE (32l << 10)
+#endif
+
+#ifndef S3Q_L2_CACHE_SIZE
+#define S3Q_L2_CACHE_SIZE (2l << 20)
+#endif
+
+namespace s3q::detail {
+
+/**
+ * Buffer size and degree of DefaultCfg, derived from the cache sizes.
+ *
+ * Each buffer fills the L1 cache and the buckets of the first level fill the
+ * L2 cache. Both can be set explicitly by defining S3Q_BUF_BASE_BYTES and
+ * S3Q_LOG_MAX_DEGREE, e.g. to the results of scripts/tune-config.
+ */
+struct CacheGeometry {
+    static constexpr std::ptrdiff_t kL1Size = S3Q_L1D_CACHE_SIZE;
+    static constexpr std::ptrdiff_t kL2Size = S3Q_L2_CACHE_SIZE;
+
+    static_assert(kL1Size > 0 && kL2Size > 0);
+
+#ifdef S3Q_BUF_BASE_BYTES
+    static constexpr std::ptrdiff_t kBufBaseBytes = S3Q_BUF_BASE_BYTES;
+#else
+    static constexpr std::ptrdiff_t kBufBaseBytes = kL1Size;
+#endif
+
+#ifdef S3Q_LOG_MAX_DEGREE
+    static constexpr int kLogMaxDegree = S3Q_LOG_MAX_DEGREE;
+#else
+    // Splits need a degree of at least 16, and classifiers of more than 256
+    // buckets outgrow the L1 cache themselves
+    static constexpr int kLogMaxDegree =
+        std::clamp(log2_floor(std::max(kL2Size / kBufBaseBytes, 1l)), 4, 8);
+#endif
+};
+
+} // namespace s3q::detail
@@ -11,14 +11,32 @@
 #include <range/v3/view/repeat.hpp>
 #include <range/v3/view/take_exactly.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
-#include <functional>
+#include <cstddef>
+#include <limits>
 #include <utility>
 
 namespace s3q::detail {
 
+/**
+ * Classifies keys into buckets given by a sorted sequence of splitters.
+ *
+ * The live buckets are a contiguous range [first_, last_] of the buckets the
+ * search tree was built for. This allows us to drop the first bucket or to
+ * join the last few buckets without rebuilding the tree: keys are simply
+ * clamped to the live range.
+ *
+ * With Cfg::kRadixSplitters, splitters are mostly the last keys of aligned
+ * bit ranges, see radixSplitters. If all of them fall onto a small grid of
+ * such ranges, a key is classified by a shift and a table lookup instead of
+ * a search tree descent.
+ */
 template <class Cfg>
 class Classifier {
+    using BucketIdx = typename Cfg::BucketIdx;
+
 public:
     Classifier() {}
 
@@ -27,8 +45,16 @@ public:
         build(rng);
     }
 
-    bool valid() const { return num_buckets_ >= 2; };
-    void invalidate() { num_buckets_ = 0; };
+    bool valid() const { return last_ - first_ >= 1; };
+    void invalidate() { last_ = first_ - 1; };
+
+    // Drops the first bucket; its keys are assigned to its successor
+    void dropFirst() { ++first_; }
+
+    // Joins all buckets from num_buckets-1 onwards into a single one
+    void truncate(BucketIdx num_buckets) {
+        last_ = std::min(last_, first_ + num_buckets - 1);
+    }
 
     // All of the following methods require:
     // sized_range<Rng>
@@ -40,12 +66,17 @@ public:
         assert(!ranges::empty(sorted_keys));
         assert(Cfg::KeyRange::contains(*ranges::cbegin(sorted_keys)));
         assert(Cfg::KeyRange::contains(*ranges::crbegin(sorted_keys)));
-        assert(ranges::is_sorted(sorted_keys));
+        assert(ranges::is_sorted(sorted_keys, Cfg::compare));
 
         const auto num_splitters = ssize(sorted_keys);
-        num_buckets_ = num_splitters + 1;
+        first_ = 0;
+        last_ = num_splitters;
+
+        if constexpr (Cfg::kRadixSplitters) {
+            if (buildTable(sorted_keys)) return;
+        }
 
-        const auto log_buckets = log2_ceil(num_buckets_);
+        const auto log_buckets = log2_ceil(last_ + 1);
         const auto next_power_of_2 = 1l << log_buckets;
 
         // pad keys with supremum to next power of two
@@ -53,30 +84,37 @@ public:
         auto padded_keys = rv::concat(sorted_keys, rv::repeat(key_sup)) |
                            rv::take_exactly(next_power_of_2 - 1);
 
-        // PERF: avoid the copying here?
+        // the padded view is written straight into ips4o's splitter buffer
         ranges::copy(padded_keys, classifier_.getSortedSplitters());
 
         classifier_.build(log_buckets);
 
         // Check that we properly classify elements for the last bucket
-        assert(classifier_.template classify<false>(
-                   *ranges::crbegin(sorted_keys) + 1) == num_splitters);
+        assert(classifier_.template classify<false>(Cfg::KeyRange::succ(
+                   *ranges::crbegin(sorted_keys))) == num_splitters);
     }
 
     template <class Rng, class Yield>
     void classify(const Rng &subjects, Yield &&yield) const {
         assert(valid());
 
-        classifier_.template classify<false>(ranges::cbegin(subjects),
-                                             ranges::cend(subjects),
-                                             std::forward<Yield>(yield));
+        if constexpr (Cfg::kRadixSplitters) {
+            if (has_table_) {
+                classifyByTable(subjects, yield);
+                return;
+            }
+        }
+
+        classifier_.template classify<false>(
+            ranges::cbegin(subjects), ranges::cend(subjects),
+            [this, &yield](BucketIdx c, auto it) { yield(live(c), it); });
     }
 
 private:
     struct Ips4oCfg {
         using value_type = typename Cfg::Key;
         using bucket_type = typename Cfg::BucketIdx;
-        using less = std::less<value_type>;
+        using less = typename Cfg::Compare;
 
         // ips4o's Classifier only has space for (kMaxBuckets / 2) splitters
         static constexpr int kLogBuckets = Cfg::kLogMaxDegree + 1;
@@ -88,9 +126,98 @@ private:
                       Cfg::kBufBaseSize / Cfg::kSplitFactor / 2);
     };
 
-    typename Cfg::BucketIdx num_buckets_ = 0;
+    using Key = typename Cfg::Key;
+    using CellIdx = std::uint16_t;
+
+    // Largest table we build before falling back to the search tree
+    static constexpr BucketIdx kMaxCells = 4 * Cfg::kMaxDegree;
+    static_assert(Cfg::kMaxDegree < 1l << 16);
+
+    /**
+     * Builds the lookup table for the cells of all splitters.
+     *
+     * The shift is the largest one at which every splitter is the last key
+     * of its cell. Then all keys of a cell belong into the same bucket.
+     * @return false, if the splitters span too many cells
+     */
+    template <class Rng>
+    bool buildTable(const Rng &sorted_keys) {
+        has_table_ = false;
+
+        // the number of trailing one bits, as k + 1 might overflow
+        auto alignment = [](Key k) {
+            return __builtin_ctzll(~static_cast<unsigned long long>(k));
+        };
+        shift_ = std::numeric_limits<Key>::digits - 1;
+        for (const Key k : sorted_keys) shift_ = std::min(shift_, alignment(k));
+
+        auto cell = [this](Key k) { return Key(k >> shift_); };
+        auto offset = [&](Key k) {
+            return static_cast<std::size_t>(cell(k) - lo_);
+        };
+        const Key last_key = *ranges::crbegin(sorted_keys);
+        lo_ = cell(*ranges::cbegin(sorted_keys));
+        const auto num_cells = offset(last_key) + 1;
+        if (num_cells > num_cast<std::size_t>(kMaxCells)) return false;
+
+        // Cell lo_ + t gets the number of splitters in cells before it. One
+        // more cell past the last splitter takes all larger keys.
+        auto it = ranges::cbegin(sorted_keys);
+        CellIdx count = 0;
+        for (std::size_t t = 0; t < num_cells; ++t) {
+            for (; count < last_ && offset(*it) < t; ++it) ++count;
+            table_[t] = count;
+        }
+        table_[num_cells] = num_cast<CellIdx>(last_);
+        end_ = Key(cell(last_key) + 1u);
+        has_table_ = true;
+
+        assert(lookup(last_key) == last_ - 1);
+        assert(lookup(Key(last_key + 1u)) == last_);
+        return true;
+    }
+
+    // Branch-free, as the clamping compiles to min and max
+    BucketIdx lookup(Key key) const {
+        const Key c = std::clamp(Key(key >> shift_), lo_, end_);
+        return table_[static_cast<std::size_t>(c - lo_)];
+    }
+
+    template <class Rng, class Yield>
+    void classifyByTable(const Rng &subjects, Yield &yield) const {
+        // Look up blocks of keys first, so that this loop is vectorized
+        constexpr std::ptrdiff_t kBlockSize = 16;
+        std::array<BucketIdx, kBlockSize> classes;
+
+        const auto first = ranges::cbegin(subjects);
+        const auto n = ranges::distance(subjects);
+        for (std::ptrdiff_t i = 0; i < n; i += kBlockSize) {
+            const auto m = std::min(kBlockSize, n - i);
+            for (std::ptrdiff_t j = 0; j < m; ++j) {
+                classes[num_cast<std::size_t>(j)] = lookup(first[i + j]);
+            }
+            for (std::ptrdiff_t j = 0; j < m; ++j) {
+                yield(live(classes[num_cast<std::size_t>(j)]), first + i + j);
+            }
+        }
+    }
+
+    // Maps a bucket of the search tree to its index among the live buckets
+    BucketIdx live(BucketIdx c) const {
+        return std::clamp(c, first_, last_) - first_;
+    }
+
+    // The range of live buckets
+    BucketIdx first_ = 0, last_ = -1;
 
     ips4o::detail::Classifier<Ips4oCfg> classifier_{typename Ips4oCfg::less()};
+
+    // Lookup table for radix splitters: cell c = key >> shift_, clamped to
+    // [lo_, end_], maps to bucket table_[c - lo_]
+    bool has_table_ = false;
+    int shift_ = 0;
+    Key lo_ = 0, end_ = 0;
+    std::array<CellIdx, kMaxCells + 1> table_;
 };
 
 } // namespace s3q::detail
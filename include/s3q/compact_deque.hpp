@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+namespace s3q::detail {
+
+/**
+ * A contiguous sequence of at most N elements with free space on both ends.
+ *
+ * Removing the first element is O(1) and inserting shifts the shorter side.
+ * Elements live in a fixed array of twice the capacity, which is only
+ * re-centered if an insertion runs out of space on both sides.
+ *
+ * Iterators are plain pointers. Like with std::vector, inserting invalidates
+ * all iterators, erasing invalidates iterators at or after the erased one.
+ * Erasing the first element only invalidates iterators to it.
+ */
+template <class T, std::size_t N>
+class CompactDeque {
+    static constexpr auto kCapacity = static_cast<std::ptrdiff_t>(2 * N);
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    iterator begin() { return data() + first_; }
+    iterator end() { return data() + last_; }
+    const_iterator begin() const { return data() + first_; }
+    const_iterator end() const { return data() + last_; }
+
+    size_type size() const { return static_cast<size_type>(last_ - first_); }
+    bool empty() const { return first_ == last_; }
+
+    reference operator[](size_type i) { return begin()[i]; }
+    const_reference operator[](size_type i) const { return begin()[i]; }
+
+    reference front() { return *begin(); }
+    reference back() { return *std::prev(end()); }
+    const_reference front() const { return *begin(); }
+    const_reference back() const { return *std::prev(end()); }
+
+    template <class... Args>
+    reference emplace_back(Args &&...args) {
+        return *insert(end(), T(std::forward<Args>(args)...));
+    }
+
+    void push_back(T value) { insert(end(), std::move(value)); }
+
+    iterator insert(const_iterator pos, T value) {
+        auto it = makeRoom(pos, 1);
+        *it = std::move(value);
+        return it;
+    }
+
+    // Inserts elements constructed from each element of [first, last)
+    template <class InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last) {
+        const auto count = std::distance(first, last);
+        auto it = makeRoom(pos, count);
+        std::transform(first, last, it, [](auto &&v) { return T(v); });
+        return it;
+    }
+
+    iterator erase(const_iterator pos) {
+        assert(begin() <= pos && pos < end());
+        auto it = begin() + (pos - begin());
+
+        if (it == begin()) {
+            *it = T();
+            ++first_;
+            return begin();
+        }
+
+        std::move(std::next(it), end(), it);
+        --last_;
+        *end() = T();
+        return it;
+    }
+
+    void clear() {
+        std::fill(begin(), end(), T());
+        first_ = last_ = kCapacity / 2;
+    }
+
+private:
+    T *data() { return storage_.data(); }
+    const T *data() const { return storage_.data(); }
+
+    // Shifts elements to make room for count elements at pos and returns
+    // an iterator to the first free slot
+    iterator makeRoom(const_iterator pos, difference_type count) {
+        assert(begin() <= pos && pos <= end());
+        assert(ssize() + count <= difference_type(N));
+        const auto idx = pos - begin();
+
+        if (first_ < count && last_ + count > kCapacity) recenter();
+
+        const bool front_is_shorter = idx < ssize() - idx;
+        const bool back_fits = last_ + count <= kCapacity;
+        if (first_ >= count && (front_is_shorter || !back_fits)) {
+            // shift the elements before pos towards the front
+            std::move(begin(), begin() + idx, begin() - count);
+            first_ -= count;
+        } else {
+            // shift the elements at and after pos towards the back
+            std::move_backward(begin() + idx, end(), end() + count);
+            last_ += count;
+        }
+
+        return begin() + idx;
+    }
+
+    // Moves all elements to the middle of the storage
+    void recenter() {
+        const auto size = ssize();
+        const auto new_first = (kCapacity - size) / 2;
+        if (new_first < first_) {
+            std::move(begin(), end(), data() + new_first);
+        } else {
+            std::move_backward(begin(), end(), data() + new_first + size);
+        }
+        first_ = new_first;
+        last_ = new_first + size;
+    }
+
+    difference_type ssize() const { return last_ - first_; }
+
+    difference_type first_ = kCapacity / 2, last_ = kCapacity / 2;
+    std::array<T, 2 * N> storage_;
+};
+
+} // namespace s3q::detail
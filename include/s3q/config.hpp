@@ -1,13 +1,20 @@
 #pragma once
 
+#include "cache.hpp"
 #include "util.hpp"
 
 #include <cstddef>
+#include <functional>
+#include <memory>
 #include <type_traits>
 #include <utility>
 
 namespace s3q {
 
+// Defined in external.hpp, which configs with external memory must include
+template <class T, class Cfg>
+struct MappedAllocator;
+
 struct DefaultCfg {
     // should be a signed integer to avoid unsigned arithmetic pitfalls
     using BucketIdx = std::ptrdiff_t;
@@ -18,13 +25,19 @@ struct DefaultCfg {
         int key, value;
     };
 
-    // Let M = kL1CacheSize, B = kL1CacheLineSize (both in Bytes)
+    // Sized after the caches of the build machine, see cache.hpp
+    static constexpr std::ptrdiff_t kBufBaseSize =
+        detail::CacheGeometry::kBufBaseBytes /
+        static_cast<std::ptrdiff_t>(sizeof(Item));
+    static constexpr int kLogMaxDegree = detail::CacheGeometry::kLogMaxDegree;
 
-    // Should be something like M / (4*sizeof(Item))
-    static constexpr std::ptrdiff_t kBufBaseSize = (1l << 15) / sizeof(Item);
+    // Batches of at least this many items are distributed in parallel, if
+    // a thread pool is provided via `static ThreadPool *threadPool()`
+    static constexpr std::ptrdiff_t kParallelThreshold = 1l << 16;
 
-    // Should be something like M / B
-    static constexpr int kLogMaxDegree = 6;
+    // Buffers of this level and beyond are stored in memory-mapped files, if
+    // a directory is provided via `static const char *externalDirectory()`
+    static constexpr int kExternalLevel = 2;
 };
 
 namespace detail {
@@ -47,6 +60,87 @@ struct GetKey {
 template <class Cfg>
 struct GetKey<Cfg, std::void_t<decltype(Cfg::GetKey)>> : Cfg::GetKey {};
 
+template <class Base>
+struct ExtendedCfg;
+
+// Whether Cfg places coarse levels in external memory
+template <class Cfg, class Enable = void>
+struct HasExternalStorage : std::false_type {};
+
+template <class Cfg>
+struct HasExternalStorage<Cfg,
+                          std::void_t<decltype(Cfg::externalDirectory())>>
+    : std::true_type {};
+
+// Allocator for item buffers: Cfg::Allocator, if provided, MappedAllocator
+// for external-memory configs and std::allocator otherwise
+template <class Cfg, class Enable = void>
+struct ItemAllocator {
+    using type = std::conditional_t<
+        HasExternalStorage<Cfg>::value,
+        MappedAllocator<typename Cfg::Item, ExtendedCfg<Cfg>>,
+        std::allocator<typename Cfg::Item>>;
+};
+
+template <class Cfg>
+struct ItemAllocator<Cfg, std::void_t<typename Cfg::Allocator>> {
+    using type = typename std::allocator_traits<
+        typename Cfg::Allocator>::template rebind_alloc<typename Cfg::Item>;
+};
+
+// Whether Cfg provides a thread pool for parallel level operations
+template <class Cfg, class Enable = void>
+struct HasThreadPool : std::false_type {};
+
+template <class Cfg>
+struct HasThreadPool<Cfg, std::void_t<decltype(Cfg::threadPool())>>
+    : std::true_type {};
+
+// Arity of the min-buffer heap: Cfg::kMinBufArity, if provided, and 2 else
+template <class Cfg, class Enable = void>
+struct MinBufArity : std::integral_constant<int, 2> {};
+
+template <class Cfg>
+struct MinBufArity<Cfg, std::void_t<decltype(Cfg::kMinBufArity)>>
+    : std::integral_constant<int, Cfg::kMinBufArity> {};
+
+// Whether Cfg asks for bit-range splitters: Cfg::kRadixSplitters or false
+template <class Cfg, class Enable = void>
+struct RadixSplitters : std::false_type {};
+
+template <class Cfg>
+struct RadixSplitters<Cfg, std::void_t<decltype(Cfg::kRadixSplitters)>>
+    : std::bool_constant<Cfg::kRadixSplitters> {};
+
+// Whether pushed keys never fall below the last popped key: Cfg::kMonotone
+// or false
+template <class Cfg, class Enable = void>
+struct Monotone : std::false_type {};
+
+template <class Cfg>
+struct Monotone<Cfg, std::void_t<decltype(Cfg::kMonotone)>>
+    : std::bool_constant<Cfg::kMonotone> {};
+
+// Order of keys: Cfg::Compare, if provided, and std::less<> for a min-queue
+// otherwise. Custom comparators need a constexpr call operator.
+template <class Cfg, class Enable = void>
+struct KeyCompare {
+    using type = std::less<>;
+};
+
+template <class Cfg>
+struct KeyCompare<Cfg, std::void_t<typename Cfg::Compare>> {
+    using type = typename Cfg::Compare;
+};
+
+// Whether Cfg collects Stats: Cfg::kCollectStats or false
+template <class Cfg, class Enable = void>
+struct CollectStats : std::false_type {};
+
+template <class Cfg>
+struct CollectStats<Cfg, std::void_t<decltype(Cfg::kCollectStats)>>
+    : std::bool_constant<Cfg::kCollectStats> {};
+
 /**
  * Extends user-config Base with derived values.
  *
@@ -59,9 +153,29 @@ struct ExtendedCfg : Base {
 
     using GetKey = ::s3q::detail::GetKey<Base>;
     using Key = std::remove_reference_t<decltype(GetKey()(Item()))>;
-    using KeyRange = detail::NumberRange<Key>;
+    using Compare = typename KeyCompare<Base>::type;
+    using KeyRange = detail::NumberRange<Key, Compare>;
+    using Allocator = typename ItemAllocator<Base>::type;
 
     static constexpr GetKey getKey{};
+    static constexpr Compare compare{};
+
+    // Whether keys are ordered by their built-in <, as in a min-queue. Only
+    // then we use vectorized heaps and bit-range splitters.
+    static constexpr bool kNaturalOrder =
+        std::is_same_v<Compare, std::less<>> ||
+        std::is_same_v<Compare, std::less<Key>>;
+    static constexpr bool kParallel = HasThreadPool<Base>::value;
+    static constexpr int kMinBufArity = MinBufArity<Base>::value;
+    static constexpr bool kMonotone = Monotone<Base>::value;
+    static constexpr bool kCollectStats = CollectStats<Base>::value;
+
+    // Bit-range splitters only work for unsigned integer keys in natural
+    // order, all other keys fall back to sampled splitters
+    static constexpr bool kRadixSplitters =
+        RadixSplitters<Base>::value && kNaturalOrder &&
+        std::is_integral_v<Key> && std::is_unsigned_v<Key> &&
+        sizeof(Key) <= sizeof(unsigned long long);
 
     using Base::kLogMaxDegree;
     static constexpr BucketIdx kMaxDegree = 1l << kLogMaxDegree;
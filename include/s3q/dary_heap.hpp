@@ -0,0 +1,241 @@
+#pragma once
+
+#include "util.hpp"
+
+#include <range/v3/core.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace s3q::detail {
+
+/**
+ * A D-ary min-heap with the same interface and layout as Heap.
+ *
+ * As in Heap, index 0 holds a sentinel and the root is at index 1. The
+ * children of node i are at [D*(i-1) + 2, D*i + 2). A wider heap has fewer
+ * levels, but has to find the minimum of D children on each of them. For
+ * D = 8 and 32-bit keys in natural order, we do that with a few AVX2
+ * instructions if they are available and with a scalar loop otherwise.
+ */
+template <class Cfg, int D>
+class DAryHeap {
+    using Index = std::ptrdiff_t;
+    using Item = typename Cfg::Item;
+    using Key = typename Cfg::Key;
+    using KeyRange = typename Cfg::KeyRange;
+
+    static_assert(D >= 2);
+
+public:
+    template <class Rng>
+    static const Item &top(const Rng &r) {
+        assert(hasSentinel(r));
+        return ranges::cbegin(r)[1];
+    }
+
+    template <class Rng>
+    static auto size(const Rng &r) {
+        assert(hasSentinel(r));
+        return ranges::size(r) - 1;
+    }
+
+    template <class Rng>
+    static bool empty(const Rng &r) {
+        return size(r) == 0;
+    }
+
+    template <class Rng>
+    static void make(Rng &&r) {
+        assert(ranges::size(r) > 0);
+
+        // put a sentinel at index 0
+        r.push_back(*ranges::cbegin(r));
+        Cfg::getKey(*ranges::begin(r)) = KeyRange::inf();
+
+        const auto data = ranges::begin(r);
+        const Index n = ssize(r);
+        if (n < 3) return;
+        for (Index i = parent(n - 1); i > 0; --i) siftDown(data, n, i);
+    }
+
+    // Restores the heap property after appending items at [first, end) to a
+    // heap with sentinel
+    template <class Rng>
+    static void extend(Rng &&r, std::ptrdiff_t first) {
+        assert(hasSentinel(r));
+        assert(first > 0);
+        const auto data = ranges::begin(r);
+        const Index n = ssize(r);
+        for (Index last = first; last < n; ++last) siftUp(data, last);
+    }
+
+    template <class Rng>
+    static void push(Rng &&r) {
+        assert(hasSentinel(r));
+        siftUp(ranges::begin(r), ssize(r) - 1);
+    }
+
+    // Like Heap::pop, the last element of r is undefined after the pop
+    template <class Rng>
+    static void pop(Rng &&r) {
+        assert(hasSentinel(r));
+        const Index maxIdx = ssize(r) - 1;
+        assert(maxIdx > 0);
+        const auto data = ranges::begin(r);
+
+        // first move up elements on a min-path
+        Index hole = 1;
+        for (Index c = firstChild(hole); c < maxIdx; c = firstChild(hole)) {
+            const auto succ = minChild(data, c, std::min(c + D, maxIdx));
+            data[hole] = data[succ];
+            hole = succ;
+        }
+
+        // then bubble up rightmost element
+        const auto el = data[maxIdx];
+        bubbleUp(data, hole, el);
+    }
+
+private:
+    static constexpr Index parent(Index i) { return (i - 2) / D + 1; }
+    static constexpr Index firstChild(Index i) { return D * (i - 1) + 2; }
+
+    template <class Rng>
+    static bool hasSentinel(const Rng &r) {
+        assert(ssize(r) > 0);
+        return Cfg::getKey(*ranges::cbegin(r)) == KeyRange::inf();
+    }
+
+    static bool keyLess(const Item &a, const Item &b) {
+        return Cfg::compare(Cfg::getKey(a), Cfg::getKey(b));
+    }
+
+    template <class It>
+    static void siftUp(It data, Index hole) {
+        const auto el = data[hole];
+        bubbleUp(data, hole, el);
+    }
+
+    // Moves the hole up until el fits in, stopping below the sentinel
+    template <class It>
+    static void bubbleUp(It data, Index hole, const Item &el) {
+        for (; hole > 1; hole = parent(hole)) {
+            const auto pred = parent(hole);
+            if (!keyLess(el, data[pred])) break;
+            data[hole] = data[pred];
+        }
+        data[hole] = el;
+    }
+
+    template <class It>
+    static void siftDown(It data, Index n, Index hole) {
+        const auto el = data[hole];
+        for (Index c = firstChild(hole); c < n; c = firstChild(hole)) {
+            const auto succ = minChild(data, c, std::min(c + D, n));
+            if (!keyLess(data[succ], el)) break;
+            data[hole] = data[succ];
+            hole = succ;
+        }
+        data[hole] = el;
+    }
+
+    // Returns the index of a child in [first, last) with the smallest key
+    template <class It>
+    static Index minChild(It data, Index first, Index last) {
+        if constexpr (kSimd) {
+            // the offset is a constant, so this check is optimized away
+            if (last - first == D && keyOffset(data[first]) == 0) {
+                return first + minOfEight(&data[first]);
+            }
+        }
+
+        Index result = first;
+        for (Index i = first + 1; i < last; ++i) {
+            if (keyLess(data[i], data[result])) result = i;
+        }
+        return result;
+    }
+
+    static std::ptrdiff_t keyOffset(const Item &item) {
+        return reinterpret_cast<const char *>(&Cfg::getKey(item)) -
+               reinterpret_cast<const char *>(&item);
+    }
+
+    // The vectorized search needs eight 32-bit keys that are either the
+    // items themselves or, as checked by minChild, the first half of 64-bit
+    // items
+    static constexpr bool keysArePackable() {
+        using KeyRef = decltype(Cfg::getKey(std::declval<Item &>()));
+        return std::is_lvalue_reference_v<KeyRef> &&
+               std::is_trivially_copyable_v<Item> &&
+               (sizeof(Item) == 4 || sizeof(Item) == 8);
+    }
+
+#ifdef __AVX2__
+    static constexpr bool kSimd =
+        D == 8 && Cfg::kNaturalOrder && keysArePackable() &&
+        (std::is_same_v<Key, float> || std::is_same_v<Key, std::int32_t> ||
+         std::is_same_v<Key, std::uint32_t>);
+
+    static __m256i loadKeys(const Item *items) {
+        if constexpr (sizeof(Item) == 4) {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(items));
+        } else {
+            // gather the low halves of four items from each vector
+            const auto lo =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(items));
+            const auto hi = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(items + 4));
+            const auto even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            return _mm256_permute2x128_si256(
+                _mm256_permutevar8x32_epi32(lo, even),
+                _mm256_permutevar8x32_epi32(hi, even), 0x20);
+        }
+    }
+
+    static Index minOfEight(const Item *items) {
+        const auto keys = loadKeys(items);
+
+        // Broadcast the minimum to all lanes, then find its first lane
+        int mask;
+        if constexpr (std::is_same_v<Key, float>) {
+            const auto v = _mm256_castsi256_ps(keys);
+            auto m = _mm256_min_ps(v, _mm256_permute_ps(v, 0xB1));
+            m = _mm256_min_ps(m, _mm256_permute_ps(m, 0x4E));
+            m = _mm256_min_ps(m, _mm256_permute2f128_ps(m, m, 0x01));
+            mask = _mm256_movemask_ps(_mm256_cmp_ps(v, m, _CMP_EQ_OQ));
+        } else {
+            auto min = [](__m256i a, __m256i b) {
+                if constexpr (std::is_signed_v<Key>) {
+                    return _mm256_min_epi32(a, b);
+                } else {
+                    return _mm256_min_epu32(a, b);
+                }
+            };
+            auto m = min(keys, _mm256_shuffle_epi32(keys, 0xB1));
+            m = min(m, _mm256_shuffle_epi32(m, 0x4E));
+            m = min(m, _mm256_permute2x128_si256(m, m, 0x01));
+            const auto eq = _mm256_cmpeq_epi32(keys, m);
+            mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        }
+
+        assert(mask != 0);
+        return __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#else
+    static constexpr bool kSimd = false;
+
+    static Index minOfEight(const Item *) { return 0; }
+#endif
+};
+
+} // namespace s3q::detail
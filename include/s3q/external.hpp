@@ -0,0 +1,221 @@
+#pragma once
+
+#if !__has_include(<sys/mman.h>)
+#error "External memory requires POSIX mmap"
+#endif
+
+#include "util.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace s3q {
+
+namespace detail {
+
+/**
+ * Backs large blocks of memory by memory-mapped temporary files.
+ *
+ * Each mapping gets its own file, which is unlinked right away, so its disk
+ * space is released as soon as the mapping is gone. Since the mapping is
+ * shared, the kernel writes cold pages back to the file instead of the swap
+ * space and reads them in again once a bucket is touched.
+ *
+ * Creating a mapping takes half a dozen system calls. Thus, mappings are
+ * rounded up to powers of two of at least kMinMappingSize and released ones
+ * are kept for reuse. The files are sparse, so rounding up only costs
+ * address space.
+ */
+class MappedStorage {
+public:
+    // These count address space and buffer sizes, not I/O. How much of it
+    // the kernel actually reads and writes is only known to getrusage.
+    struct Stats {
+        // Total size of all buffers ever placed in files
+        std::atomic<std::uint64_t> buffer_bytes{0};
+
+        // Total size of all mappings ever created and destroyed, including
+        // the rounding to powers of two
+        std::atomic<std::uint64_t> address_space_mapped{0};
+        std::atomic<std::uint64_t> address_space_unmapped{0};
+    };
+
+    static Stats &stats() {
+        static Stats stats;
+        return stats;
+    }
+
+    static constexpr std::size_t kMinMappingSize = std::size_t{1} << 20;
+
+    // Each size class keeps at most this many released mappings
+    static constexpr std::size_t kMaxFreeMappings = 8;
+
+    explicit MappedStorage(const char *directory) : directory_(directory) {
+        for (auto &free_list : free_lists_) free_list.reserve(kMaxFreeMappings);
+    }
+    MappedStorage(const MappedStorage &) = delete;
+    MappedStorage &operator=(const MappedStorage &) = delete;
+
+    void *allocate(std::size_t bytes) {
+        stats().buffer_bytes += bytes;
+        const auto cls = sizeClass(bytes);
+        {
+            std::lock_guard lock(mutex_);
+            auto &free_list = free_lists_[cls];
+            if (!free_list.empty()) {
+                auto *block = free_list.back();
+                free_list.pop_back();
+                return block;
+            }
+        }
+        return map(classSize(cls));
+    }
+
+    void deallocate(void *block, std::size_t bytes) noexcept {
+        const auto cls = sizeClass(bytes);
+        {
+            std::lock_guard lock(mutex_);
+            auto &free_list = free_lists_[cls];
+            if (free_list.size() < kMaxFreeMappings) {
+#ifdef MADV_REMOVE
+                // Drop the stale contents instead of writing them back
+                ::madvise(block, classSize(cls), MADV_REMOVE);
+#endif
+                free_list.push_back(block);
+                return;
+            }
+        }
+        ::munmap(block, classSize(cls));
+        stats().address_space_unmapped += classSize(cls);
+    }
+
+private:
+    static constexpr std::size_t kNumClasses = 44;
+
+    static std::size_t sizeClass(std::size_t bytes) {
+        if (bytes <= kMinMappingSize) return 0;
+        return num_cast<std::size_t>(log2_ceil(bytes) -
+                                     log2_ceil(kMinMappingSize));
+    }
+
+    static std::size_t classSize(std::size_t cls) {
+        return kMinMappingSize << cls;
+    }
+
+    void *map(std::size_t bytes) const {
+        std::string path = directory_ + "/s3q.XXXXXX";
+        std::vector<char> path_buf(path.begin(), path.end());
+        path_buf.push_back('\0');
+
+        const int fd = ::mkstemp(path_buf.data());
+        if (fd < 0) throw std::bad_alloc();
+        ::unlink(path_buf.data());
+
+        void *block = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+            block = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                           fd, 0);
+        }
+        ::close(fd);
+        if (block == MAP_FAILED) throw std::bad_alloc();
+
+        // Buckets are mostly scanned from front to back
+        ::madvise(block, bytes, MADV_SEQUENTIAL);
+
+        stats().address_space_mapped += bytes;
+        return block;
+    }
+
+    const std::string directory_;
+    std::mutex mutex_;
+    std::array<std::vector<void *>, kNumClasses> free_lists_;
+};
+
+} // namespace detail
+
+/**
+ * Allocator that places the buffers of coarse levels in external memory.
+ *
+ * Buffers that can only belong to level Cfg::kExternalLevel or beyond, i.e.
+ * that hold at least the minimum bucket size of that level, are backed by
+ * files in Cfg::externalDirectory(). All smaller buffers use std::allocator.
+ *
+ * The allocator only sees sizes, not levels. Thus, any large item buffer of
+ * the queue ends up in a file as well, including transient ones such as the
+ * input copies of assign and merge or a max-buffer that push_range fills
+ * with a large range.
+ *
+ * ExtendedCfg picks this allocator for every Cfg that provides
+ * `static const char *externalDirectory()`. Such configs have to include
+ * this header, which pulls in the POSIX headers for mmap.
+ */
+template <class T, class Cfg>
+struct MappedAllocator {
+    using value_type = T;
+
+    template <class U>
+    struct rebind {
+        using other = MappedAllocator<U, Cfg>;
+    };
+
+    MappedAllocator() noexcept = default;
+
+    template <class U>
+    MappedAllocator(const MappedAllocator<U, Cfg> &) noexcept {}
+
+    static std::size_t externalMinBytes() {
+        auto items = Cfg::kBufBaseSize / Cfg::kSplitFactor;
+        for (int lvl = 0; lvl < Cfg::kExternalLevel; ++lvl) {
+            items *= Cfg::kGrowthRate;
+        }
+        return static_cast<std::size_t>(items) * sizeof(T);
+    }
+
+    T *allocate(std::size_t n) {
+        const auto bytes = n * sizeof(T);
+        if (bytes < externalMinBytes()) return std::allocator<T>().allocate(n);
+
+        return static_cast<T *>(storage().allocate(bytes));
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept {
+        const auto bytes = n * sizeof(T);
+        if (bytes < externalMinBytes()) {
+            std::allocator<T>().deallocate(p, n);
+        } else {
+            storage().deallocate(p, bytes);
+        }
+    }
+
+    // Shared by all queues of Cfg. It is never destroyed, so that static
+    // queues can still return their buffers at exit.
+    static detail::MappedStorage &storage() {
+        static auto *storage =
+            new detail::MappedStorage(Cfg::externalDirectory());
+        return *storage;
+    }
+
+    template <class U>
+    bool operator==(const MappedAllocator<U, Cfg> &) const noexcept {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const MappedAllocator<U, Cfg> &) const noexcept {
+        return false;
+    }
+};
+
+} // namespace s3q
@@ -5,8 +5,8 @@
 #include <range/v3/core.hpp>
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
-#include <functional>
 #include <iterator>
 #include <utility>
 
@@ -18,8 +18,6 @@ class Heap {
     using Item = typename Cfg::Item;
     using KeyRange = typename Cfg::KeyRange;
 
-    static constexpr std::greater<> comp_{};
-
 public:
     template <class Rng>
     static const Item &top(const Rng &r) {
@@ -49,6 +47,25 @@ public:
         make_heap(ranges::begin(r) + 1, ranges::end(r), keyGreater);
     }
 
+    // Restores the heap property after appending items at [first, end) to a
+    // heap with sentinel. Falls back to bulk construction for large batches.
+    template <class Rng>
+    static void extend(Rng &&r, std::ptrdiff_t first) {
+        assert(hasSentinel(r));
+        assert(first > 0);
+        const auto data = ranges::begin(r);
+        const Index n = ssize(r);
+        const Index num_new = n - first;
+
+        if (num_new * log2_floor(n) < n) {
+            for (Index last = first; last < n; ++last) {
+                bubbleUpLastFrom(ranges::subrange(data, data + last + 1), last);
+            }
+        } else {
+            make_heap(data + 1, data + n, keyGreater);
+        }
+    }
+
     // like ranges::push_heap except that we require a sentinel at idx 0
     template <class Rng>
     static void push(Rng &&r) {
@@ -84,12 +101,13 @@ private:
         return Cfg::getKey(*ranges::cbegin(r)) == KeyRange::inf();
     }
 
+    // Orders by Cfg::compare, so the top is the minimum in that order
     static bool keyLess(const Item &a, const Item &b) {
-        return Cfg::getKey(a) < Cfg::getKey(b);
+        return Cfg::compare(Cfg::getKey(a), Cfg::getKey(b));
     }
 
     static bool keyGreater(const Item &a, const Item &b) {
-        return Cfg::getKey(a) > Cfg::getKey(b);
+        return Cfg::compare(Cfg::getKey(b), Cfg::getKey(a));
     }
 
     template <class Rng>
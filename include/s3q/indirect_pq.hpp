@@ -0,0 +1,112 @@
+#pragma once
+
+#include "config.hpp"
+#include "pq.hpp"
+#include "stats.hpp"
+#include "util.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace s3q::detail {
+
+/**
+ * A PriorityQueue that keeps the payloads of large items out of its buckets.
+ *
+ * Items are parked in a payload array on push. Buckets, classifiers and the
+ * min-buffer only handle small entries made of a key and a payload index,
+ * so a split or flush moves a few bytes per item, no matter how large the
+ * items are. Each payload moves exactly twice: into the payload array on
+ * push and out of it on pop.
+ *
+ * Only the basic operations are supported, i.e. no bulk pops, assign, merge,
+ * save or load. Payload slots are reused, and all of them are released
+ * once the queue runs empty.
+ */
+template <class Cfg>
+class IndirectPriorityQueue {
+public:
+    using Item = typename Cfg::Item;
+    using Key = typename Cfg::Key;
+
+    std::size_t size() const { return queue_.size(); }
+
+    bool empty() const { return queue_.empty(); }
+
+    const Item &top() const {
+        assert(!empty());
+        return payloads_[queue_.top().index];
+    }
+
+    void push(Item item) {
+        assert(Cfg::KeyRange::contains(Cfg::getKey(item)));
+        queue_.push(park(std::move(item)));
+    }
+
+    // Parks all payloads first, then pushes their entries at once
+    template <class Rng>
+    void push_range(Rng &&items) {
+        std::vector<Entry> entries;
+        if constexpr (ranges::sized_range<Rng>) {
+            entries.reserve(ranges::size(items));
+        }
+        for (auto &&item : items) {
+            assert(Cfg::KeyRange::contains(Cfg::getKey(item)));
+            entries.push_back(park(std::forward<decltype(item)>(item)));
+        }
+        queue_.push_range(entries);
+    }
+
+    Stats stats() const { return queue_.stats(); }
+
+    Item pop() {
+        assert(!empty());
+        const auto index = queue_.pop().index;
+        Item item = std::move(payloads_[index]);
+        if (queue_.empty()) {
+            payloads_ = {};
+            free_indices_ = {};
+        } else {
+            free_indices_.push_back(index);
+        }
+        return item;
+    }
+
+private:
+    using Index = std::uint32_t;
+
+    struct Entry {
+        Key key;
+        Index index;
+    };
+
+    struct EntryCfg : Cfg {
+        using Item = Entry;
+    };
+
+    using Queue = PriorityQueue<ExtendedCfg<EntryCfg>>;
+
+    // Stores item in a free payload slot and returns its entry
+    template <class T>
+    Entry park(T &&item) {
+        Index index;
+        if (free_indices_.empty()) {
+            index = num_cast<Index>(payloads_.size());
+            payloads_.push_back(std::forward<T>(item));
+        } else {
+            index = free_indices_.back();
+            free_indices_.pop_back();
+            payloads_[index] = std::forward<T>(item);
+        }
+        return {Cfg::getKey(payloads_[index]), index};
+    }
+
+    std::vector<Item> payloads_;
+    std::vector<Index> free_indices_;
+    Queue queue_;
+};
+
+} // namespace s3q::detail
@@ -2,10 +2,14 @@
 
 #include "bucket.hpp"
 #include "classifier.hpp"
+#include "compact_deque.hpp"
 #include "sampling.hpp"
+#include "serialize.hpp"
+#include "stats.hpp"
 #include "util.hpp"
 
 #include <range/v3/action/insert.hpp>
+#include <range/v3/algorithm/partition.hpp>
 #include <range/v3/core.hpp>
 #include <range/v3/numeric/accumulate.hpp>
 #include <range/v3/view/drop_exactly.hpp>
@@ -14,9 +18,13 @@
 #include <range/v3/view/transform.hpp>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <istream>
 #include <iterator>
+#include <ostream>
 #include <utility>
 #include <vector>
 
@@ -27,7 +35,10 @@ class Level {
 public:
     using Bucket = ::s3q::detail::Bucket<Cfg>;
     using BucketIdx = typename Cfg::BucketIdx;
-    using SplitterSampler = ::s3q::detail::SplitterSampler<>;
+    using Buffer = typename Bucket::Buffer;
+    using SplitterSampler =
+        ::s3q::detail::SplitterSampler<typename Cfg::Compare>;
+    using Splitters = std::vector<typename Cfg::Key>;
 
     // Ctor for first level
     explicit Level(SplitterSampler &sampler)
@@ -47,6 +58,21 @@ public:
 
     BucketIdx degree() const { return ssize(buckets_); }
 
+    // Supremum of the last regular bucket. All items in coarser levels are
+    // larger than this.
+    typename Cfg::Key lastSplitter() const {
+        if (degree() < 2) return Cfg::KeyRange::inf();
+        return std::prev(buckets_.end(), 2)->sup;
+    }
+
+    // Bounds on the number of items insert accepts at once
+    std::ptrdiff_t minBatchSize() const {
+        const auto min_size = std::max(minBucketSize() / Cfg::kGrowthRate,
+                                       Cfg::kBufBaseSize / Cfg::kSplitFactor);
+        return (min_size + 1) / 2;
+    }
+    std::ptrdiff_t maxBatchSize() const { return 2 * kMaxBucketSize_; }
+
     Bucket delMin() {
         assert(!buckets_.empty());
 
@@ -54,9 +80,9 @@ public:
         auto result = std::move(buckets_.front());
         buckets_.erase(buckets_.begin());
 
-        classifier_.invalidate();
+        classifier_.dropFirst();
 
-        assert(ssize(result.buf) <= kMaxBucketSize_);
+        assert(ssize(result.buf) <= kMaxBucketSize_ || result.all_equal);
         traceState("delMin:after");
         return result;
     }
@@ -72,6 +98,8 @@ public:
 
         if (buckets_.size() == 0) buckets_.push_back({});
 
+        count(&LevelStats::items_moved, items.size());
+
         if (buckets_.size() == 1) {
             // we have only one bucket, so just append all items onto it
             // this can only happen in the last level
@@ -89,17 +117,20 @@ public:
         traceState("insert:after");
     }
 
-    void insertMin(Bucket &&b) {
+    // Inserts b as first bucket and splits it at the given splitters, which
+    // are sampled from b if there are none
+    void insertMin(Bucket &&b, Splitters splitters = {}) {
         assert(degree() <= Cfg::kMaxDegree);
         assert(ssize(b.buf) >= kMaxBucketSize_);
-        assert(ssize(b.buf) <= 3 * kMaxBucketSize_);
+        assert(ssize(splitters) < Cfg::kSplitFactor);
 
         SizeChecker sc{*this, size() + b.buf.size()};
 
         buckets_.insert(buckets_.begin(), std::move(b));
+        classifier_.invalidate();
 
         shrinkToDegree(Cfg::kMaxDegree - Cfg::kSplitFactor + 1);
-        splitAt(0);
+        splitAt(0, Cfg::kSplitFactor, std::move(splitters));
 
         traceState("insertMin:after");
     }
@@ -110,10 +141,12 @@ public:
     }
 
     void refillFrom(Level &next_level) {
-        assert(degree() == Cfg::kMinDegree + 1);
+        // Refills may steal more than one bucket from next level
+        assert(degree() <= Cfg::kMinDegree + 1);
         assert(next_level.degree() > 0);
 
         S3Q_TRACE << "event=refill_from_next lvl=" << idx() << "\n";
+        count(&LevelStats::refills);
 
         // flush max-buf (alternative would be to merge it with incoming items)
         flushMaxBufInto</*flush_all=*/true>(next_level);
@@ -121,29 +154,166 @@ public:
         // steal min-buf from next level
         buckets_.back() = next_level.delMin();
         is_last_ = (next_level.degree() == 0);
+        splitStolenBucket();
+
+        // Buckets next to equality buckets may be small, as may be the
+        // max-buf after an equality bucket became a regular one. As all of
+        // its items are less than those of next level, a small max-buf
+        // becomes a regular bucket and we steal the next one. Only the last
+        // level may be emptied that way.
+        constexpr auto kMaxRefillDegree = Cfg::kMaxDegree - Cfg::kSplitFactor;
+        auto can_steal = [&next_level] {
+            return next_level.degree() > (next_level.is_last_ ? 0 : 1);
+        };
+        while (can_steal() && 2 * maxBufSize() < minBucketSize() &&
+               degree() < kMaxRefillDegree) {
+            S3Q_TRACE << "event=refill_again lvl=" << idx() << "\n";
+            if (maxBufSize() == 0) {
+                buckets_.back() = next_level.delMin();
+            } else {
+                buckets_.emplace_back(next_level.delMin());
+                classifier_.invalidate();
+            }
+            is_last_ = (next_level.degree() == 0);
+            splitStolenBucket();
+        }
+    }
 
-        // Since we push at least ɑ-1 times our minBucketSize, the incoming
-        // bucket must have at least as many elements
-        assert(maxBufSize() >= (Cfg::kSplitFactor - 1) * minBucketSize());
+    // Moves all buckets out of this level, leaving it empty
+    std::vector<Bucket> takeBuckets() {
+        classifier_.invalidate();
+        is_last_ = true;
+        std::vector<Bucket> result(std::make_move_iterator(buckets_.begin()),
+                                   std::make_move_iterator(buckets_.end()));
+        buckets_.clear();
+        return result;
+    }
 
-        // If we did not pull the last bucket from next level, the bucket size
-        // is guaranteed to be at least k/2 times that of our own min-size
-        const auto full_split_threshold = minBucketSize() * Cfg::kGrowthRate;
-        assert(is_last_ || maxBufSize() >= full_split_threshold / 2);
+    /**
+     * Bulk-loads this empty level with the smallest items it can hold.
+     *
+     * Buckets are laid out by a single split of the level's share of items,
+     * so we get the same structure as after a regular flush into this level.
+     * @return the items that belong into coarser levels
+     */
+    Buffer assign(Buffer &&items) {
+        assert(buckets_.empty());
+        if (items.empty()) return {};
+
+        constexpr auto kTargetDegree = Cfg::kMaxDegree - Cfg::kSplitFactor;
+        const auto bucket_size = kMaxBucketSize_ / 2;
+        const auto n = ssize(items);
+
+        if (n <= kMaxBucketSize_) {
+            buckets_.emplace_back();
+            buckets_.back().buf = std::move(items);
+            traceState("assign:after");
+            return {};
+        }
 
-        // In any case, next level's max-size constraint must be satisfied
-        assert(maxBufSize() <= Cfg::kGrowthRate * kMaxBucketSize_);
+        // Sample splitters for buckets of half the max size. If there are
+        // more of them than fit into this level, everything beyond the
+        // kTargetDegree-th splitter belongs into coarser levels. The split
+        // below reuses these splitters instead of sampling again.
+        auto keys_view = ranges::transform_view(items, Cfg::getKey);
+        const auto num_buckets = (n + bucket_size - 1) / bucket_size;
+        auto samples = getSplitters(keys_view, num_buckets);
+
+        if (ssize(samples) <= kTargetDegree) {
+            // all items fit into this level, so this is the last one
+            buckets_.emplace_back();
+            buckets_.back().buf = std::move(items);
+
+            const auto split_degree = std::clamp(
+                n / bucket_size, Cfg::kSplitFactor, kTargetDegree);
+            splitAt(0, split_degree,
+                    thinSplitters(std::move(samples), split_degree));
+            traceState("assign:after");
+            return {};
+        }
 
-        // If we pulled next level's last bucket, it might be small enough
-        if (maxBufSize() <= kMaxBucketSize_) return;
+        const auto sep = samples.begin()[kTargetDegree - 1];
+        auto is_min = [sep](const auto &k) { return !Cfg::compare(sep, k); };
+        auto rest_begin = ranges::partition(items, is_min, Cfg::getKey);
+        Buffer rest(std::make_move_iterator(rest_begin),
+                    std::make_move_iterator(items.end()));
+        items.erase(rest_begin, items.end());
+        assert(!rest.empty());
+
+        // Leave max-buf in the same state as after flushMaxBufInto
+        const auto max_buf_size = std::min(minBucketSize(), ssize(rest));
+        Buffer max_buf(std::make_move_iterator(rest.end() - max_buf_size),
+                       std::make_move_iterator(rest.end()));
+        rest.erase(rest.end() - max_buf_size, rest.end());
+        is_last_ = rest.empty();
+
+        buckets_.emplace_back(sep);
+        buckets_.back().buf = std::move(items);
+        buckets_.emplace_back();
+        buckets_.back().buf = std::move(max_buf);
+
+        // sep becomes the sup of the last new bucket
+        samples.resize(kTargetDegree - 1);
+        splitAt(0, kTargetDegree, std::move(samples));
+        traceState("assign:after");
+        return rest;
+    }
 
-        // PERF: maybe round split_degree down to next power of two
-        const auto split_degree = maxBufSize() >= full_split_threshold
-                                      ? Cfg::kGrowthRate
-                                      : maxBufSize() / minBucketSize();
+    // The counters of this level and the memory its buffers currently hold
+    LevelStats stats() const {
+        auto result = stats_;
+        for (const auto &b : buckets_) {
+            result.bytes_allocated +=
+                b.buf.capacity() * sizeof(typename Cfg::Item);
+        }
+        return result;
+    }
 
-        S3Q_TRACE << "event=split_max degree=" << split_degree << "\n";
-        splitAt(degree() - 1, split_degree);
+    // Writes the buckets of this level, i.e. their sups and buffers
+    void save(std::ostream &os) const {
+        writeFlag(os, is_last_);
+        writeValue(os, degree());
+        for (const auto &b : buckets_) {
+            writeValue(os, b.sup);
+            writeFlag(os, b.all_equal);
+            writeBuffer(os, b.buf);
+        }
+    }
+
+    /**
+     * Restores the buckets of this empty level as written by save.
+     *
+     * Items are neither classified nor are splitters sampled. The search
+     * tree is only built from the restored sups once it is needed. We only
+     * check that the sups are in order and not less than floor, the last
+     * splitter of all finer levels, but not the keys of the items.
+     */
+    bool load(std::istream &is, const typename Cfg::Key &floor) {
+        assert(buckets_.empty());
+
+        BucketIdx num_buckets;
+        if (!readFlag(is, is_last_) || !readValue(is, num_buckets)) {
+            return false;
+        }
+        if (num_buckets < 0 || num_buckets > Cfg::kMaxDegree) return false;
+
+        auto prev_sup = floor;
+        for (BucketIdx i = 0; i < num_buckets; ++i) {
+            auto &b = buckets_.emplace_back();
+            if (!readValue(is, b.sup) || !readFlag(is, b.all_equal) ||
+                !readBuffer(is, b.buf)) {
+                return false;
+            }
+
+            const bool valid_sup = b.sup == Cfg::KeyRange::sup() ||
+                                   Cfg::KeyRange::contains(b.sup);
+            if (!valid_sup || Cfg::compare(b.sup, prev_sup)) return false;
+            prev_sup = b.sup;
+        }
+
+        classifier_.invalidate();
+        traceState("load:after");
+        return true;
     }
 
 private:
@@ -192,15 +362,144 @@ private:
         // PERF maybe rebuild eagerly?
         if (!classifier_.valid()) {
             S3Q_TRACE << "event=rebuild_classifier lvl=" << idx() << "\n";
+            count(&LevelStats::classifier_builds);
             classifier_.build(splitters());
         }
 
+        if constexpr (Cfg::kParallel) {
+            auto *pool = Cfg::threadPool();
+            if (pool && ssize(items) >= Cfg::kParallelThreshold) {
+                distributeParallel(*pool, items);
+                return;
+            }
+        }
+
         auto keys_view = items | rv::transform(Cfg::getKey);
         classifier_.classify(keys_view, [this](auto c, auto it) {
             bucket(c).buf.push_back(*it.base());
         });
     }
 
+    /**
+     * Distributes items using all threads of pool.
+     *
+     * Like ips4o's parallel partitioning, every thread first classifies a
+     * stripe of items and counts them per bucket. The prefix sums of these
+     * counts tell each thread where to write its items, so all buckets are
+     * grown once up front and threads scatter into disjoint slots.
+     */
+    template <class Pool, class Rng>
+    void distributeParallel(Pool &pool, Rng &items) {
+        using ClassIdx = std::uint16_t;
+        using Counts = std::array<std::ptrdiff_t, Cfg::kMaxDegree>;
+        static_assert(Cfg::kMaxDegree <= 1l << 16);
+
+        const auto n = ssize(items);
+        const auto first = ranges::begin(items);
+        const auto num_threads = pool.numThreads();
+        auto stripe = [n, num_threads](std::ptrdiff_t t) {
+            return firstOfStripe(n, t, num_threads);
+        };
+
+        std::vector<Counts> offsets(num_cast<std::size_t>(num_threads));
+        std::vector<ClassIdx> classes(num_cast<std::size_t>(n));
+
+        pool([&](std::ptrdiff_t t, std::ptrdiff_t) {
+            auto &counts = offsets[num_cast<std::size_t>(t)];
+            counts = Counts{};
+
+            const auto part_begin = first + stripe(t);
+            auto part = ranges::subrange(part_begin, first + stripe(t + 1));
+            auto keys_view = part | rv::transform(Cfg::getKey);
+            classifier_.classify(keys_view, [&](auto c, auto it) {
+                ++counts[num_cast<std::size_t>(c)];
+                classes[num_cast<std::size_t>(it.base() - first)] =
+                    num_cast<ClassIdx>(c);
+            });
+        });
+
+        // turn counts into write positions and grow each bucket only once
+        for (BucketIdx c = 0; c < degree(); ++c) {
+            auto &buf = bucket(c).buf;
+            auto pos = ssize(buf);
+            for (auto &counts : offsets) {
+                pos += std::exchange(counts[num_cast<std::size_t>(c)], pos);
+            }
+            buf.resize(num_cast<std::size_t>(pos));
+        }
+
+        pool([&](std::ptrdiff_t t, std::ptrdiff_t) {
+            auto &positions = offsets[num_cast<std::size_t>(t)];
+            for (auto i = stripe(t); i < stripe(t + 1); ++i) {
+                const auto c = classes[num_cast<std::size_t>(i)];
+                auto &pos = positions[c];
+                bucket(c).buf.begin()[pos++] = first[i];
+            }
+        });
+    }
+
+    // The first index of the t-th of num_threads stripes of n items
+    static std::ptrdiff_t firstOfStripe(std::ptrdiff_t n, std::ptrdiff_t t,
+                                        std::ptrdiff_t num_threads) {
+        return n / num_threads * t + std::min(t, n % num_threads);
+    }
+
+    // Picks splitters at even ranks, such that they make fewer than
+    // split_degree buckets
+    static Splitters thinSplitters(Splitters splitters,
+                                   BucketIdx split_degree) {
+        const auto num_buckets = ssize(splitters) + 1;
+        if (num_buckets <= split_degree) return splitters;
+
+        Splitters result;
+        result.reserve(num_cast<std::size_t>(split_degree - 1));
+        for (BucketIdx i = 1; i < split_degree; ++i) {
+            result.push_back(splitters[num_cast<std::size_t>(
+                i * num_buckets / split_degree - 1)]);
+        }
+        return result;
+    }
+
+    // Splitters for a split into at most num_buckets buckets. The bulk load
+    // in assign always samples, as it needs splitters at given ranks.
+    template <class Rng>
+    auto selectSplitters(Rng &&keys, BucketIdx num_buckets) {
+        if constexpr (Cfg::kRadixSplitters) {
+            return radixSplitters(keys, num_buckets);
+        } else {
+            return getSplitters(keys, num_buckets);
+        }
+    }
+
+    // Splits the max-buf right after it was stolen from next level
+    void splitStolenBucket() {
+        // Next level's max-size constraint must be satisfied
+        assert(maxBufSize() <= Cfg::kGrowthRate * kMaxBucketSize_ ||
+               buckets_.back().all_equal);
+
+        // An equality bucket becomes a regular one
+        if (buckets_.back().all_equal) {
+            splitAt(degree() - 1);
+            return;
+        }
+
+        // If we pulled next level's last bucket or one next to an equality
+        // bucket, it might be small enough
+        if (maxBufSize() <= kMaxBucketSize_) return;
+
+        // If we did not pull the last bucket from next level, the bucket size
+        // is usually at least k/2 times that of our own min-size
+        const auto full_split_threshold = minBucketSize() * Cfg::kGrowthRate;
+
+        // PERF: maybe round split_degree down to next power of two
+        const auto split_degree = maxBufSize() >= full_split_threshold
+                                      ? Cfg::kGrowthRate
+                                      : maxBufSize() / minBucketSize();
+
+        S3Q_TRACE << "event=split_max degree=" << split_degree << "\n";
+        splitAt(degree() - 1, split_degree);
+    }
+
     template <bool flush_all>
     void flushMaxBufInto(Level &next_level) {
         assert(degree() > Cfg::kMinDegree);
@@ -230,6 +529,7 @@ private:
         // PERF: this is quadratic in the worst case
         for (BucketIdx idx = begin; idx < end - 1; ++idx) {
             if (ssize(bucket(idx).buf) <= kMaxBucketSize_) continue;
+            if (bucket(idx).all_equal) continue;
 
             // split the overflowing bucket
             const auto split_end = splitAt(idx);
@@ -243,7 +543,8 @@ private:
         const auto kMaxSplitDegree = Cfg::kMaxDegree - Cfg::kSplitFactor + 1;
         const bool max_buf_splittable = is_last_ && end <= kMaxSplitDegree;
         if ((end < degree() || max_buf_splittable) &&
-            ssize(bucket(end - 1).buf) > kMaxBucketSize_) {
+            ssize(bucket(end - 1).buf) > kMaxBucketSize_ &&
+            !bucket(end - 1).all_equal) {
             // bucket(end-1) is not a max-buf so we split it too if it overflows
             end = splitAt(end - 1);
         }
@@ -256,22 +557,29 @@ private:
         if (auto diff = degree() - target_degree; diff > 0) {
             S3Q_TRACE << "event=join lvl=" << idx() << " count=" << diff
                       << "\n";
+            count(&LevelStats::joins, num_cast<std::uint64_t>(diff));
 
-            classifier_.invalidate();
+            classifier_.truncate(target_degree);
         }
 
         while (degree() > target_degree) {
             // remove last regular bucket and join it onto max-buf
             auto b_it = buckets_.end() - 2;
             auto &max_buf = buckets_.back().buf;
+            count(&LevelStats::items_moved, b_it->buf.size());
             append(max_buf, rv::move(b_it->buf));
             buckets_.erase(b_it);
         }
     }
 
     BucketIdx splitAt(BucketIdx idx,
-                      BucketIdx split_degree = Cfg::kSplitFactor) {
+                      BucketIdx split_degree = Cfg::kSplitFactor,
+                      Splitters splitters = {}) {
         SizeChecker sc{*this};
+
+        // equality buckets are never split
+        if (bucket(idx).all_equal) return keepEqualBucket(idx);
+
         assert(split_degree >= Cfg::kSplitFactor);
 
         // degree needs to be <= this value to be able to do an ɑ-way split
@@ -282,6 +590,7 @@ private:
         if (idx >= kMaxSplitSize - 1) {
             traceState("retire");
             S3Q_TRACE << "idx=" << idx << "\n";
+            count(&LevelStats::retires);
             // flush all buckets in range [idx, degree-1)
             shrinkToDegree(idx + 1);
             return idx;
@@ -301,21 +610,28 @@ private:
 
         // determine splitters and insert them together with empty buffers
         // the old splitter becomes the supremum of the last new bucket
-        auto splitters = getSplitters(keys_view, split_degree);
+        if (splitters.empty()) {
+            splitters = selectSplitters(keys_view, split_degree);
+        }
         auto num_new_buckets = ssize(splitters);
         assert(num_new_buckets < split_degree);
-        ranges::insert(buckets_, buckets_.begin() + idx, splitters);
+        buckets_.insert(buckets_.begin() + idx, splitters.begin(),
+                        splitters.end());
         classifier_.invalidate();
 
         S3Q_TRACE << "event=split:splitters lvl=" << this->idx()
                   << " idx=" << idx << " degree=" << ssize(splitters) + 1
                   << "\n";
 
+        count(&LevelStats::splits);
+        count(&LevelStats::classifier_builds);
+        count(&LevelStats::items_moved, buf.size());
+
         // PERF: only use local classifier if split_degree ≪ degree()
         Classifier classifier{splitters};
         const auto split_begin = buckets_.begin() + idx;
         classifier.classify(keys_view, [split_begin](auto c, auto it) {
-            split_begin[c].buf.push_back(*it.base());
+            split_begin[c].buf.push_back(std::move(*it.base()));
         });
 
         // From right to left, join underflowing buckets onto their predecessors
@@ -324,6 +640,8 @@ private:
             S3Q_TRACE << "event=split:repair lvl=" << this->idx()
                       << " idx=" << std::distance(split_begin, it) << "\n";
             auto prev = std::prev(it);
+            count(&LevelStats::joins);
+            count(&LevelStats::items_moved, it->buf.size());
             append(prev->buf, rv::move(it->buf));
             prev->sup = it->sup;
             buckets_.erase(it);
@@ -336,6 +654,8 @@ private:
                       << "\n";
             assert(std::next(split_begin) < buckets_.end());
             auto &next = std::next(split_begin)->buf;
+            count(&LevelStats::joins);
+            count(&LevelStats::items_moved, split_begin->buf.size());
             append(next, rv::move(split_begin->buf));
             buckets_.erase(split_begin);
             --num_new_buckets;
@@ -343,9 +663,146 @@ private:
 
         assert(num_new_buckets >= 0);
 
+        // A split fails to make progress if most items share one key, which
+        // no split separates, or if the splitters did not fit the keys, as
+        // even or bit-range splitters of skewed keys. Then we sample anew.
+        if (num_new_buckets == 0 && ssize(bucket(idx).buf) > kMaxBucketSize_) {
+            if (hasDominantKey(idx)) return splitOffEqual(idx);
+
+            S3Q_TRACE << "event=split:resample lvl=" << this->idx()
+                      << " idx=" << idx << "\n";
+            auto keys = ranges::transform_view(bucket(idx).buf, Cfg::getKey);
+            return splitAt(idx, split_degree, getSplitters(keys, split_degree));
+        }
+
         return fixOverflowingBuckets(idx, idx + num_new_buckets + 1);
     }
 
+    // Whether more than half of the items of bucket idx share its median key
+    bool hasDominantKey(BucketIdx idx) {
+        auto &buf = bucket(idx).buf;
+        auto key_less = [](const auto &a, const auto &b) {
+            return Cfg::compare(Cfg::getKey(a), Cfg::getKey(b));
+        };
+        const auto mid = buf.begin() + ssize(buf) / 2;
+        std::nth_element(buf.begin(), mid, buf.end(), key_less);
+
+        const auto key = Cfg::getKey(*mid);
+        const auto num_equal = std::count_if(
+            buf.begin(), buf.end(),
+            [key](const auto &item) { return Cfg::getKey(item) == key; });
+        return 2 * num_equal > ssize(buf);
+    }
+
+    /**
+     * Splits bucket idx into the items less than, equal to and greater than
+     * its median key, like the equal buckets of ips4o.
+     *
+     * The bucket of the median key is marked as all-equal and never split
+     * again, so it is eventually handed out as a whole. The other two may be
+     * arbitrarily small.
+     * @return the end of the range of buckets that replaced bucket idx
+     */
+    BucketIdx splitOffEqual(BucketIdx idx) {
+        auto &buf = bucket(idx).buf;
+        auto key_less = [](const auto &a, const auto &b) {
+            return Cfg::compare(Cfg::getKey(a), Cfg::getKey(b));
+        };
+        const auto mid = buf.begin() + ssize(buf) / 2;
+        std::nth_element(buf.begin(), mid, buf.end(), key_less);
+        const auto key = Cfg::getKey(*mid);
+
+        // nth_element leaves keys <= key before mid and keys >= key after it
+        auto is_less = [key](const auto &k) { return Cfg::compare(k, key); };
+        auto is_equal = [key](const auto &k) { return !Cfg::compare(key, k); };
+        const auto equal_begin =
+            ranges::partition(buf.begin(), mid, is_less, Cfg::getKey);
+        const auto equal_end =
+            ranges::partition(mid, buf.end(), is_equal, Cfg::getKey);
+
+        Bucket less(Cfg::KeyRange::pred(key)), greater(bucket(idx).sup);
+        less.buf.assign(std::make_move_iterator(buf.begin()),
+                        std::make_move_iterator(equal_begin));
+        greater.buf.assign(std::make_move_iterator(equal_end),
+                           std::make_move_iterator(buf.end()));
+        buf.erase(equal_end, buf.end());
+        buf.erase(buf.begin(), equal_begin);
+
+        S3Q_TRACE << "event=split:equal lvl=" << this->idx() << " idx=" << idx
+                  << " size=" << buf.size() << "\n";
+        count(&LevelStats::equal_buckets);
+        count(&LevelStats::items_moved, less.buf.size() + greater.buf.size());
+
+        const bool is_max_buf = idx + 1 == degree();
+        bucket(idx).sup = key;
+        bucket(idx).all_equal = true;
+        classifier_.invalidate();
+
+        // A max-buf is needed even if there are no greater items
+        BucketIdx num_buckets = 1;
+        if (!greater.buf.empty() || is_max_buf) {
+            buckets_.insert(buckets_.begin() + idx + 1, std::move(greater));
+            ++num_buckets;
+        }
+
+        if (!less.buf.empty()) {
+            buckets_.insert(buckets_.begin() + idx, std::move(less));
+            ++num_buckets;
+        } else if (guardEqualBucket(idx) > idx) {
+            ++num_buckets;
+        }
+
+        return fixOverflowingBuckets(idx, idx + num_buckets);
+    }
+
+    /**
+     * Lets only the key of equality bucket idx be classified into it, by
+     * giving its predecessor that key's predecessor as sup. If it has no
+     * predecessor or that is an equality bucket too, an empty one is added.
+     * @return the new index of the equality bucket
+     */
+    BucketIdx guardEqualBucket(BucketIdx idx) {
+        assert(bucket(idx).all_equal);
+        const auto guard = Cfg::KeyRange::pred(bucket(idx).sup);
+        classifier_.invalidate();
+
+        if (idx > 0 && !bucket(idx - 1).all_equal) {
+            assert(!Cfg::compare(guard, bucket(idx - 1).sup));
+            bucket(idx - 1).sup = guard;
+            return idx;
+        }
+
+        buckets_.insert(buckets_.begin() + idx, Bucket(guard));
+        return idx + 1;
+    }
+
+    /**
+     * Leaves equality bucket idx as it is, unless it is the max-buf. Then it
+     * becomes a regular bucket followed by an empty max-buf, if there is
+     * room for both, or an ordinary max-buf otherwise.
+     * @return the end of the range of buckets that replaced bucket idx
+     */
+    BucketIdx keepEqualBucket(BucketIdx idx) {
+        if (idx + 1 < degree()) return idx + 1;
+
+        // leave room for a guard and the new max-buf
+        if (degree() > Cfg::kMaxDegree - Cfg::kSplitFactor) {
+            bucket(idx).all_equal = false;
+            return idx + 1;
+        }
+
+        auto &b = bucket(idx);
+        assert(!b.buf.empty());
+        b.sup = Cfg::getKey(b.buf.front());
+        buckets_.emplace_back();
+        return guardEqualBucket(idx) + 1;
+    }
+
+    // Adds n to one of our counters, if Cfg collects stats at all
+    void count(std::uint64_t LevelStats::*counter, std::uint64_t n = 1) {
+        if constexpr (Cfg::kCollectStats) stats_.*counter += n;
+    }
+
     void traceState(const char *event_name) {
         S3Q_TRACE << "event=Level::" << event_name << " lvl=" << idx()
                   << " max_size=" << kMaxBucketSize_ << " degree=" << degree()
@@ -361,10 +818,12 @@ private:
 
     const std::ptrdiff_t kMaxBucketSize_;
 
-    // PERF: use compact linked list for buckets (needs in-place partitioning)
-    std::vector<Bucket> buckets_;
+    // Holds one extra bucket, since insertMin adds one before shrinking
+    CompactDeque<Bucket, Cfg::kMaxDegree + 1> buckets_;
 
     Classifier classifier_;
+
+    LevelStats stats_;
 };
 
 } // namespace s3q::detail
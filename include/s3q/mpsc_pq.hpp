@@ -0,0 +1,130 @@
+#pragma once
+
+#include "pq.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace s3q::detail {
+
+/**
+ * A PriorityQueue that many threads push into and a single thread pops from.
+ *
+ * Producers never touch the queue itself. Each one fills a private chunk of
+ * kBufBaseSize items and publishes it on a lock-free stack once it is full.
+ * The consumer takes all published chunks with a single atomic exchange
+ * before each pop and pushes them into its queue with push_range, which
+ * routes items to the min- or max-buffer by comparing with the min-bucket's
+ * supremum.
+ */
+template <class Cfg>
+class MpscPriorityQueue {
+    using Queue = PriorityQueue<Cfg>;
+
+    struct Chunk {
+        typename Queue::Buffer items;
+        Chunk *next = nullptr;
+    };
+
+public:
+    using Item = typename Cfg::Item;
+
+    // Buffers the pushes of one producer thread
+    class Producer {
+    public:
+        explicit Producer(MpscPriorityQueue &queue) : queue_(&queue) {}
+
+        Producer(Producer &&) noexcept = default;
+        Producer &operator=(Producer &&) = delete;
+
+        ~Producer() { flush(); }
+
+        void push(Item item) {
+            assert(Cfg::KeyRange::contains(Cfg::getKey(item)));
+            if (!chunk_) {
+                chunk_ = std::make_unique<Chunk>();
+                chunk_->items.reserve(Cfg::kBufBaseSize);
+            }
+
+            chunk_->items.push_back(std::move(item));
+            if (ssize(chunk_->items) == Cfg::kBufBaseSize) flush();
+        }
+
+        // Publishes all items pushed so far
+        void flush() {
+            if (chunk_ && !chunk_->items.empty()) {
+                queue_->publish(std::move(chunk_));
+            }
+        }
+
+    private:
+        MpscPriorityQueue *queue_;
+        std::unique_ptr<Chunk> chunk_;
+    };
+
+    MpscPriorityQueue() = default;
+    MpscPriorityQueue(const MpscPriorityQueue &) = delete;
+    MpscPriorityQueue &operator=(const MpscPriorityQueue &) = delete;
+
+    ~MpscPriorityQueue() { deleteChunks(published_.exchange(nullptr)); }
+
+    // May be called by any thread, but producers must not outlive the queue
+    Producer producer() { return Producer(*this); }
+
+    // All of the following methods may only be called by the consumer
+
+    // Counts queued items and published ones that are yet to be collected
+    std::size_t size() const {
+        return queue_.size() + num_published_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    bool try_pop(Item &out) {
+        collect();
+        if (queue_.empty()) return false;
+        out = queue_.pop();
+        return true;
+    }
+
+    // Moves all published chunks into the queue
+    void collect() {
+        if (!published_.load(std::memory_order_relaxed)) return;
+
+        auto *chunks = published_.exchange(nullptr, std::memory_order_acquire);
+        for (auto *chunk = chunks; chunk; chunk = chunk->next) {
+            num_published_.fetch_sub(chunk->items.size(),
+                                     std::memory_order_relaxed);
+            queue_.push_range(chunk->items);
+        }
+        deleteChunks(chunks);
+    }
+
+private:
+    void publish(std::unique_ptr<Chunk> chunk) {
+        num_published_.fetch_add(chunk->items.size(),
+                                 std::memory_order_relaxed);
+
+        // Only the consumer removes chunks and it takes all of them at once,
+        // so this push cannot suffer from the ABA problem
+        auto *head = chunk.release();
+        head->next = published_.load(std::memory_order_relaxed);
+        while (!published_.compare_exchange_weak(head->next, head,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+        }
+    }
+
+    static void deleteChunks(Chunk *chunk) {
+        while (chunk) delete std::exchange(chunk, chunk->next);
+    }
+
+    std::atomic<Chunk *> published_{nullptr};
+    std::atomic<std::size_t> num_published_{0};
+    Queue queue_;
+};
+
+} // namespace s3q::detail
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "pq.hpp"
+#include "sampling.hpp"
+#include "util.hpp"
+
+#include <XoshiroCpp.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace s3q::detail {
+
+/**
+ * A relaxed concurrent priority queue made up of many sequential ones.
+ *
+ * Following the MultiQueue design by Rihani, Sanders and Dementiev, items
+ * are spread over c·p shards, each of which is a PriorityQueue guarded by a
+ * try-lock. A push goes to a random shard. A pop looks at the cached top
+ * keys of two random shards and takes the item from the better one. Thus
+ * pops do not return the exact minimum, but one of small expected rank.
+ *
+ * @see https://arxiv.org/abs/1411.1209
+ */
+template <class Cfg>
+class MultiQueue {
+    using Key = typename Cfg::Key;
+    using KeyRange = typename Cfg::KeyRange;
+
+    static_assert(std::is_trivially_copyable_v<Key>,
+                  "top keys of shards are cached in atomics");
+
+public:
+    using Item = typename Cfg::Item;
+
+    static constexpr std::size_t kDefaultShardsPerThread = 2;
+
+    explicit MultiQueue(
+        std::size_t num_threads = std::thread::hardware_concurrency(),
+        std::size_t shards_per_thread = kDefaultShardsPerThread)
+        : num_shards_(
+              std::max(std::size_t{1}, num_threads * shards_per_thread)),
+          shards_(std::make_unique<Shard[]>(num_shards_)) {}
+
+    MultiQueue(const MultiQueue &) = delete;
+    MultiQueue &operator=(const MultiQueue &) = delete;
+
+    // Only exact if no other thread is modifying the queue
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < num_shards_; ++i) n += shards_[i].size();
+        return n;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    std::size_t num_shards() const { return num_shards_; }
+
+    void push(Item item) {
+        assert(KeyRange::contains(Cfg::getKey(item)));
+        for (;;) {
+            auto &shard = randomShard();
+            if (!shard.tryLock()) continue;
+
+            shard.pq.push(std::move(item));
+            shard.unlock();
+            return;
+        }
+    }
+
+    /**
+     * Pops an item of small rank into out.
+     *
+     * Returns false iff all shards were found empty during a final scan.
+     */
+    bool try_pop(Item &out) {
+        for (;;) {
+            auto *best = &randomShard(), *other = &randomShard();
+            if (Cfg::compare(other->topKey(), best->topKey())) {
+                std::swap(best, other);
+            }
+
+            // Both shards look empty, so check all of them before giving up
+            if (best->topKey() == KeyRange::sup()) return popAny(out);
+
+            if (!best->tryLock()) continue;
+            const bool found = best->tryPop(out);
+            best->unlock();
+            if (found) return true;
+        }
+    }
+
+private:
+    static constexpr std::size_t kCacheLineSize = 64;
+
+    // Shards are cache-aligned, so threads working on neighbors don't collide
+    struct alignas(kCacheLineSize) Shard {
+        PriorityQueue<Cfg> pq;
+
+        bool tryLock() {
+            return !locked_.load(std::memory_order_relaxed) &&
+                   !locked_.exchange(true, std::memory_order_acquire);
+        }
+
+        void lock() {
+            while (!tryLock()) std::this_thread::yield();
+        }
+
+        // Publishes the new top key and size before releasing the lock
+        void unlock() {
+            const auto top = pq.empty() ? KeyRange::sup() : topKeyOf(pq);
+            top_key_.store(top, std::memory_order_relaxed);
+            size_.store(pq.size(), std::memory_order_relaxed);
+            locked_.store(false, std::memory_order_release);
+        }
+
+        // Requires the lock to be held
+        bool tryPop(Item &out) {
+            if (pq.empty()) return false;
+            out = pq.pop();
+            return true;
+        }
+
+        Key topKey() const { return top_key_.load(std::memory_order_relaxed); }
+
+        std::size_t size() const {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static Key topKeyOf(const PriorityQueue<Cfg> &pq) {
+            return Cfg::getKey(pq.top());
+        }
+
+        std::atomic<bool> locked_{false};
+        std::atomic<Key> top_key_{KeyRange::sup()};
+        std::atomic<std::size_t> size_{0};
+    };
+
+    static auto &urbg() {
+        static thread_local XoshiroCpp::Xoshiro128StarStar urbg(
+            std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        return urbg;
+    }
+
+    std::size_t randomIndex() const {
+        const auto n = num_cast<std::uint32_t>(num_shards_);
+        return lemire::uniformRandomInt(urbg(), n);
+    }
+
+    Shard &randomShard() { return shards_[randomIndex()]; }
+
+    // Pops from the first non-empty shard of a scan starting at random
+    bool popAny(Item &out) {
+        const auto first = randomIndex();
+        for (std::size_t i = 0; i < num_shards_; ++i) {
+            auto &shard = shards_[(first + i) % num_shards_];
+            if (shard.topKey() == KeyRange::sup()) continue;
+
+            shard.lock();
+            const bool found = shard.tryPop(out);
+            shard.unlock();
+            if (found) return true;
+        }
+        return false;
+    }
+
+    const std::size_t num_shards_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace s3q::detail
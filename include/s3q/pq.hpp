@@ -1,37 +1,55 @@
 #pragma once
 
 #include "batched_pq.hpp"
+#include "dary_heap.hpp"
 #include "heap.hpp"
+#include "sampling.hpp"
+#include "serialize.hpp"
+#include "stats.hpp"
 #include "util.hpp"
 
 #include <range/v3/algorithm/partition.hpp>
+#include <range/v3/algorithm/sort.hpp>
 #include <range/v3/view/move.hpp>
 
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <istream>
 #include <iterator>
+#include <ostream>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace s3q::detail {
 
+/**
+ * With Cfg::kMonotone, pushed keys must never be less than the last popped
+ * key, as in discrete-event simulation. The queue then knows a lower bound
+ * on the keys of its min-bucket and splits an overflowing min-bucket at
+ * evenly spaced splitters between that bound and the bucket's sup, which
+ * the backend retired as the first splitter of its finest level. This saves
+ * sampling and sorting splitters on every min-bucket overflow.
+ */
 template <class Cfg>
 class PriorityQueue {
     using BatchedPriorityQueue = ::s3q::detail::BatchedPriorityQueue<Cfg>;
-    using Bucket = typename BatchedPriorityQueue::Bucket;
-    using Buffer = typename Bucket::Buffer;
-    using Heap = ::s3q::detail::Heap<Cfg>;
+    // The min-buffer is a binary heap unless Cfg asks for a wider one
+    using Heap = std::conditional_t<Cfg::kMinBufArity == 2,
+                                    ::s3q::detail::Heap<Cfg>,
+                                    DAryHeap<Cfg, Cfg::kMinBufArity>>;
 
 public:
+    using Bucket = typename BatchedPriorityQueue::Bucket;
+    using Buffer = typename Bucket::Buffer;
     using Item = typename Cfg::Item;
+    using Key = typename Cfg::Key;
 
     PriorityQueue() {
         minBuf().reserve(Cfg::kBufBaseSize + 1);
-
-        // add sentinel
-        minBuf().resize(1);
-        Cfg::getKey(minBuf()[0]) = Cfg::KeyRange::inf();
+        addSentinel();
     }
 
     std::size_t size() const {
@@ -48,21 +66,262 @@ public:
 
     void push(Item item) {
         assert(Cfg::KeyRange::contains(Cfg::getKey(item)));
-        if (Cfg::getKey(item) > min_bucket_.sup) {
+        assert(!Cfg::kMonotone || !Cfg::compare(Cfg::getKey(item), floor_));
+        if (Cfg::compare(min_bucket_.sup, Cfg::getKey(item))) {
             insertIntoMaxBuf(std::move(item));
         } else {
             insertIntoMinBuf(std::move(item));
         }
     }
 
+    /**
+     * Pushes all items of a range at once.
+     *
+     * Each item is only compared against the min-bucket's supremum and
+     * appended to either buffer. The heap property of the min-buffer is
+     * restored once at the end instead of after every item, and the
+     * max-buffer is handed to the backend in chunks of kBufBaseSize.
+     */
+    template <class Rng>
+    void push_range(Rng &&items) {
+        auto heap_end = ssize(minBuf());
+
+        for (auto &&item : items) {
+            assert(Cfg::KeyRange::contains(Cfg::getKey(item)));
+            assert(!Cfg::kMonotone ||
+                   !Cfg::compare(Cfg::getKey(item), floor_));
+            if (Cfg::compare(min_bucket_.sup, Cfg::getKey(item))) {
+                max_buffer_.push_back(item);
+                continue;
+            }
+
+            minBuf().push_back(item);
+            checkEqualMinBucket(Cfg::getKey(item));
+
+            // Flush eagerly, so we use the right splitter on the next item
+            if (minBufOverflow()) {
+                removeSentinel();
+                flushMinBuf();
+                Heap::make(minBuf());
+                heap_end = ssize(minBuf());
+            }
+        }
+
+        Heap::extend(minBuf(), heap_end);
+
+        // Flushing the min-buffer only lowers its sup, so all collected items
+        // still belong to the backend
+        auto first = max_buffer_.begin();
+        while (max_buffer_.end() - first >= Cfg::kBufBaseSize) {
+            const auto last = first + Cfg::kBufBaseSize;
+            backend_.insert(ranges::subrange(first, last));
+            first = last;
+        }
+        max_buffer_.erase(max_buffer_.begin(), first);
+    }
+
+    /**
+     * Replaces the contents of this queue by the items of a range.
+     *
+     * Builds the backend's level structure directly, which is much cheaper
+     * than pushing all items one by one.
+     */
+    template <class Rng>
+    void assign(Rng &&items) {
+        Buffer buf;
+        append(buf, std::forward<Rng>(items));
+
+        min_bucket_ = Bucket();
+        max_buffer_.clear();
+        floor_ = Cfg::KeyRange::inf();
+        equal_size_ = 0;
+
+        if (ssize(buf) > Cfg::kBufBaseSize) {
+            backend_.assign(std::move(buf));
+            takeMinBucket();
+        } else {
+            backend_.assign({});
+            minBuf() = std::move(buf);
+        }
+
+        if (minBuf().empty()) {
+            addSentinel();
+        } else {
+            Heap::make(minBuf());
+        }
+    }
+
+    /**
+     * Moves all items of other into this queue.
+     *
+     * The backends are merged bucket by bucket. Only the (small) min- and
+     * max-buffers of both queues are pushed item by item.
+     */
+    void merge(PriorityQueue &&other) {
+        assert(&other != this);
+
+        // Our min-bucket might overlap with other's backend, so we take it
+        // apart together with all other buffers
+        Buffer loose = takeBuffers();
+        auto other_loose = other.takeBuffers();
+        other.addSentinel();
+        append(loose, rv::move(other_loose));
+
+        auto leftovers = backend_.merge(std::move(other.backend_));
+        append(loose, rv::move(leftovers));
+        floor_ = std::min(floor_, other.floor_, Cfg::compare);
+
+        if (!onlyMinBufLeft()) fetchMinBucket();
+        if (minBuf().empty()) {
+            addSentinel();
+        } else {
+            Heap::make(minBuf());
+        }
+
+        push_range(std::move(loose));
+    }
+
     Item pop() {
         assert(!empty());
         auto item = popMinBuf();
+        if constexpr (Cfg::kMonotone) floor_ = Cfg::getKey(item);
         if (Heap::empty(minBuf()) && !empty()) refillMinBuf();
         return item;
     }
 
+    /**
+     * Pops the whole min-bucket at once (relaxed pop).
+     *
+     * The items of the returned bucket are in arbitrary order. Their keys are
+     * at most the bucket's sup, which is less than any key left in the queue.
+     */
+    Bucket pop_bucket() {
+        assert(!empty());
+
+        removeSentinel();
+        Bucket result{min_bucket_.sup};
+        std::swap(result.buf, minBuf());
+
+        if (onlyMinBufLeft()) {
+            addSentinel();
+        } else {
+            fetchMinBucket();
+            Heap::make(minBuf());
+        }
+
+        return result;
+    }
+
+    /**
+     * Pops the k smallest items and writes them to out in ascending order.
+     *
+     * Whenever k covers the whole min-bucket, the bucket is sorted and moved
+     * to out without ever being turned into a heap.
+     */
+    template <class OutputIt>
+    OutputIt pop_n(std::size_t k, OutputIt out) {
+        assert(k <= size());
+
+        out = drainMinBuckets(
+            [&k](std::size_t n, const Key &) {
+                if (n > k) return false;
+                k -= n;
+                return true;
+            },
+            out);
+
+        for (; k > 0; --k) *out++ = pop();
+        return out;
+    }
+
+    /**
+     * Pops all items with a key of at most key and writes them to out in
+     * ascending order.
+     */
+    template <class OutputIt>
+    OutputIt pop_until(const Key &key, OutputIt out) {
+        out = drainMinBuckets(
+            [&key](std::size_t, const Key &sup) {
+                return !Cfg::compare(key, sup);
+            },
+            out);
+
+        while (!empty() && !Cfg::compare(key, Cfg::getKey(top()))) {
+            *out++ = pop();
+        }
+        return out;
+    }
+
+    /**
+     * Counters of structural events in the backend, e.g. to relate latency
+     * spikes to splits or refills. Requires `kCollectStats = true` in Cfg.
+     */
+    Stats stats() const {
+        static_assert(Cfg::kCollectStats, "Cfg does not collect stats");
+        return backend_.stats();
+    }
+
+    /**
+     * Writes the state of this queue to os in a binary format.
+     *
+     * All buffers are written as contiguous blocks along with the bucket
+     * sups, so load can restore the exact same structure. The format
+     * depends on the platform and the Cfg.
+     */
+    void save(std::ostream &os) const {
+        writeValue(os, kFormatTag);
+        writeValue(os, min_bucket_.sup);
+        writeBuffer(os, min_bucket_.buf);
+        writeBuffer(os, max_buffer_);
+        backend_.save(os);
+    }
+
+    /**
+     * Replaces the contents of this queue by a state written by save.
+     *
+     * No item is classified or compared. We check the structure, i.e. the
+     * sizes, the order of all sups and the heap sentinel, but not the keys
+     * of the items, so only load input written by save. If the input is
+     * malformed, the failbit of is gets set and this queue is left empty.
+     */
+    void load(std::istream &is) {
+        FormatTag tag;
+        const bool ok = readValue(is, tag) && tag == kFormatTag &&
+                        readValue(is, min_bucket_.sup) &&
+                        readBuffer(is, min_bucket_.buf) &&
+                        readBuffer(is, max_buffer_) && backend_.load(is) &&
+                        !minBuf().empty() &&
+                        Cfg::getKey(minBuf()[0]) == Cfg::KeyRange::inf() &&
+                        ssize(max_buffer_) < Cfg::kBufBaseSize;
+        floor_ = Cfg::KeyRange::inf();
+        min_bucket_.all_equal = false;
+        equal_size_ = 0;
+        if (ok) return;
+
+        is.setstate(std::ios::failbit);
+        min_bucket_ = Bucket();
+        max_buffer_.clear();
+        backend_.assign({});
+        addSentinel();
+    }
+
 private:
+    // Identifies the format and the parameters the structure depends on
+    struct FormatTag {
+        std::uint32_t magic, item_size;
+        std::int64_t buf_base_size, log_max_degree;
+
+        bool operator==(const FormatTag &o) const {
+            return magic == o.magic && item_size == o.item_size &&
+                   buf_base_size == o.buf_base_size &&
+                   log_max_degree == o.log_max_degree;
+        }
+    };
+
+    static constexpr FormatTag kFormatTag{0x53335132, sizeof(Item),
+                                          Cfg::kBufBaseSize,
+                                          Cfg::kLogMaxDegree};
+
     static constexpr bool overflow(const Buffer &buf) {
         return ssize(buf) >= Cfg::kBufBaseSize;
     }
@@ -80,15 +339,12 @@ private:
     }
 
     void insertIntoMinBuf(Item item) {
+        checkEqualMinBucket(Cfg::getKey(item));
         minBuf().push_back(std::move(item));
 
         // Flush eagerly, so we use the right splitter on next insert
-        if (ssize(minBuf()) > Cfg::kBufBaseSize) {
-            // remove heap sentinel
-            auto last = std::prev(minBuf().end());
-            minBuf()[0] = std::move(*last);
-            minBuf().erase(last);
-
+        if (minBufOverflow()) {
+            removeSentinel();
             flushMinBuf();
             Heap::make(minBuf());
         } else {
@@ -96,39 +352,153 @@ private:
         }
     }
 
+    void addSentinel() {
+        assert(minBuf().empty());
+        minBuf().resize(1);
+        Cfg::getKey(minBuf()[0]) = Cfg::KeyRange::inf();
+    }
+
+    void removeSentinel() {
+        auto last = std::prev(minBuf().end());
+        minBuf()[0] = std::move(*last);
+        minBuf().erase(last);
+    }
+
+    // Like empty(), but does not require a heap sentinel in the min-buffer
+    bool onlyMinBufLeft() const {
+        return max_buffer_.empty() && backend_.size() == 0;
+    }
+
+    // Removes all items from min- and max-buffer and returns them
+    Buffer takeBuffers() {
+        removeSentinel();
+        Buffer items = std::move(minBuf());
+        append(items, rv::move(max_buffer_));
+
+        min_bucket_ = Bucket();
+        max_buffer_.clear();
+        equal_size_ = 0;
+        return items;
+    }
+
     void refillMinBuf() {
         assert(Heap::empty(minBuf()));
         assert(!empty());
 
-        if (backend_.size() == 0) {
-            // remove heap sentinel
-            minBuf().clear();
+        // remove heap sentinel
+        minBuf().clear();
 
+        fetchMinBucket();
+        Heap::make(minBuf());
+    }
+
+    // Replaces the empty min-bucket w/out sentinel by the next bucket.
+    // The items of the new min-buffer are left in arbitrary order.
+    void fetchMinBucket() {
+        assert(minBuf().empty());
+        assert(!onlyMinBufLeft());
+
+        if (backend_.size() == 0) {
             // Backend is empty so max-buf is our new min-buf
-            min_bucket_.sup = Cfg::KeyRange::sup();
+            min_bucket_ = Bucket();
             std::swap(minBuf(), max_buffer_);
+            equal_size_ = 0;
         } else {
             // Get a new min-bucket from the backend & classify the existing
             // max-buf as either belonging to the new min-bucket or not
-            min_bucket_ = backend_.delMin();
+            takeMinBucket();
             reclassifyMaxBuf();
-            if (ssize(minBuf()) > Cfg::kBufBaseSize) flushMinBuf();
+            if (minBufOverflow()) flushMinBuf();
         }
+    }
+
+    /**
+     * Moves whole min-buckets to out in ascending order for as long as
+     * take(bucket_size, bucket_sup) holds. Each bucket is sorted instead of
+     * being made into a heap. The min-buffer heap is valid afterwards.
+     */
+    template <class TakeBucket, class OutputIt>
+    OutputIt drainMinBuckets(TakeBucket take, OutputIt out) {
+        if (empty() || !take(Heap::size(minBuf()), min_bucket_.sup)) {
+            return out;
+        }
+
+        removeSentinel();
+        do {
+            auto &b = minBuf();
+            ranges::sort(b, Cfg::compare, Cfg::getKey);
+            out = std::move(b.begin(), b.end(), out);
+            b.clear();
+
+            if (onlyMinBufLeft()) {
+                addSentinel();
+                return out;
+            }
+
+            fetchMinBucket();
+        } while (take(minBuf().size(), min_bucket_.sup));
 
         Heap::make(minBuf());
+        return out;
     }
 
     void flushMinBuf() {
         // ɑ-way split min-bucket, keep the min and push rest into backend
-        backend_.insertMin(std::move(min_bucket_));
+        backend_.insertMin(std::move(min_bucket_), minBucketSplitters());
+        takeMinBucket();
+    }
+
+    void takeMinBucket() {
         min_bucket_ = backend_.delMin();
+        equal_size_ = min_bucket_.all_equal ? ssize(minBuf()) : 0;
+    }
+
+    // Items less than the sup of an equality bucket break its equality
+    void checkEqualMinBucket(const Key &key) {
+        if (min_bucket_.all_equal && Cfg::compare(key, min_bucket_.sup)) {
+            min_bucket_.all_equal = false;
+        }
+    }
+
+    /**
+     * Whether the min-buffer holds too many items to stay a heap.
+     *
+     * An equality bucket may be arbitrarily large, but splitting it would
+     * not help. So only kBufBaseSize items on top of it count, and no items
+     * at all as long as all of them share its key.
+     */
+    bool minBufOverflow() {
+        if (ssize(minBuf()) <= Cfg::kBufBaseSize + equal_size_) return false;
+        if (!min_bucket_.all_equal) return true;
+
+        equal_size_ = ssize(minBuf());
+        return false;
+    }
+
+    // Splitters for an overflowing min-bucket, if they can be inferred from
+    // monotone keys. Otherwise, the backend samples them.
+    typename BatchedPriorityQueue::Splitters minBucketSplitters() const {
+        if constexpr (Cfg::kMonotone) {
+            const auto sup = min_bucket_.sup;
+            const bool bounded = Cfg::KeyRange::contains(floor_) &&
+                                 Cfg::KeyRange::contains(sup);
+            if (bounded && Cfg::compare(floor_, sup)) {
+                return evenSplitters(floor_, sup, Cfg::kSplitFactor);
+            }
+        }
+        return {};
     }
 
     void reclassifyMaxBuf() {
         // move all items from max-buf that are <= sup(min-buf) to min-buf
-        auto is_max = [sup = min_bucket_.sup](auto k) { return sup < k; };
+        auto is_max = [sup = min_bucket_.sup](auto k) {
+            return Cfg::compare(sup, k);
+        };
         auto min_begin = ranges::partition(max_buffer_, is_max, Cfg::getKey);
         auto min_items = ranges::subrange(min_begin, max_buffer_.end());
+        for (const auto &item : min_items) {
+            checkEqualMinBucket(Cfg::getKey(item));
+        }
         append(minBuf(), rv::move(min_items));
         max_buffer_.erase(min_items.begin(), min_items.end());
     }
@@ -146,6 +516,13 @@ private:
     Bucket min_bucket_;
     Buffer max_buffer_;
     BatchedPriorityQueue backend_;
+
+    // With monotone keys, a lower bound on all keys that are in the queue or
+    // will ever be pushed: the last popped key
+    Key floor_ = Cfg::KeyRange::inf();
+
+    // The size of the min-buffer when it last held only an equality bucket
+    std::ptrdiff_t equal_size_ = 0;
 };
 
 } // namespace s3q::detail
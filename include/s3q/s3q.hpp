@@ -1,16 +1,38 @@
 #pragma once
 
+#include "addressable_pq.hpp"
+#include "allocator.hpp"
 #include "batched_pq.hpp"
 #include "config.hpp"
+#include "indirect_pq.hpp"
+#include "mpsc_pq.hpp"
+#include "multi_queue.hpp"
 #include "pq.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
 
 namespace s3q {
 
 template <class Cfg = DefaultCfg>
 using PriorityQueue = detail::PriorityQueue<detail::ExtendedCfg<Cfg>>;
 
+// Keeps large payloads out of the buckets, but only supports push and pop
+template <class Cfg = DefaultCfg>
+using IndirectPriorityQueue =
+    detail::IndirectPriorityQueue<detail::ExtendedCfg<Cfg>>;
+
 template <class Cfg = DefaultCfg>
 using BatchedPriorityQueue =
     detail::BatchedPriorityQueue<detail::ExtendedCfg<Cfg>>;
 
+template <class Cfg = DefaultCfg>
+using AddressablePriorityQueue =
+    detail::AddressablePriorityQueue<detail::ExtendedCfg<Cfg>>;
+
+template <class Cfg = DefaultCfg>
+using MultiQueue = detail::MultiQueue<detail::ExtendedCfg<Cfg>>;
+
+template <class Cfg = DefaultCfg>
+using MpscPriorityQueue = detail::MpscPriorityQueue<detail::ExtendedCfg<Cfg>>;
+
 } // namespace s3q
@@ -5,6 +5,7 @@
 #include <XoshiroCpp.hpp>
 
 #include <range/v3/action/sort.hpp>
+#include <range/v3/algorithm/minmax.hpp>
 #include <range/v3/core.hpp>
 #include <range/v3/view/drop_exactly.hpp>
 #include <range/v3/view/stride.hpp>
@@ -14,7 +15,9 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <limits>
+#include <type_traits>
 #include <vector>
 
 namespace s3q::detail {
@@ -67,7 +70,9 @@ U uniformRandomInt(Urbg &g, U range) {
 
 } // namespace lemire
 
-template <class Urbg = XoshiroCpp::Xoshiro128StarStar>
+// Samples splitters, sorted by Compare
+template <class Compare = std::less<>,
+          class Urbg = XoshiroCpp::Xoshiro128StarStar>
 class SplitterSampler {
     using UrbgResult = typename Urbg::result_type;
 
@@ -102,7 +107,8 @@ public:
 
         using namespace ranges;
 
-        auto sample = selectSample(keys, sample_size) | actions::sort;
+        auto sample =
+            selectSample(keys, sample_size) | actions::sort(Compare{});
 
         auto splitters = sample | views::drop_exactly(step - 1) |
                          views::stride(step) | views::unique;
@@ -112,4 +118,75 @@ public:
     }
 };
 
+/**
+ * Picks splitters from the key range instead of a sample of the keys.
+ *
+ * For unsigned integer keys in [min, max], we take the smallest shift s such
+ * that at most num_buckets cells [c << s, (c+1) << s) cover all keys. The
+ * splitters are the last keys of all but the last of these cells. So they
+ * cost a single scan over the keys, and a key's bucket only depends on
+ * key >> s, which Classifier exploits.
+ */
+template <class Rng>
+auto radixSplitters(Rng &&keys, std::ptrdiff_t num_buckets) {
+    using Key = ranges::range_value_t<Rng>;
+    static_assert(std::is_unsigned_v<Key>);
+    assert(!ranges::empty(keys));
+    assert(num_buckets > 1);
+
+    const auto [min, max] = ranges::minmax(keys);
+    const auto max_cells = num_cast<Key>(num_buckets - 1);
+
+    int shift = 0;
+    while (Key(max >> shift) - Key(min >> shift) > max_cells) ++shift;
+
+    std::vector<Key> splitters;
+    for (Key c = min >> shift; c < Key(max >> shift); ++c) {
+        splitters.push_back(Key(Key(Key(c + 1) << shift) - 1u));
+    }
+
+    // All keys are in a single cell, so there is nothing to split
+    if (splitters.empty()) splitters.push_back(max);
+    return splitters;
+}
+
+/**
+ * Splits the key range (lo, hi) into num_buckets parts of equal width.
+ *
+ * Splitters lie strictly between lo and hi and are ordered from lo to hi, so
+ * hi < lo for keys in descending order. If the range is too narrow to hold
+ * num_buckets - 1 distinct ones, fewer of them are returned.
+ */
+template <class Key>
+std::vector<Key> evenSplitters(Key lo, Key hi, std::ptrdiff_t num_buckets) {
+    assert(lo < hi || hi < lo);
+    assert(num_buckets > 1);
+
+    if (hi < lo) {
+        auto splitters = evenSplitters(hi, lo, num_buckets);
+        std::reverse(splitters.begin(), splitters.end());
+        return splitters;
+    }
+
+    std::vector<Key> splitters;
+    if constexpr (std::is_integral_v<Key>) {
+        // unsigned arithmetic, as hi - lo might not fit into Key
+        using U = std::make_unsigned_t<Key>;
+        const auto step = U(U(U(hi) - U(lo)) / static_cast<U>(num_buckets));
+        if (step == 0) return splitters;
+
+        for (std::ptrdiff_t i = 1; i < num_buckets; ++i) {
+            splitters.push_back(Key(U(U(lo) + U(step * U(i)))));
+        }
+    } else {
+        const auto step = (hi - lo) / static_cast<Key>(num_buckets);
+        for (std::ptrdiff_t i = 1; i < num_buckets; ++i) {
+            const auto s = lo + step * static_cast<Key>(i);
+            const auto prev = splitters.empty() ? lo : splitters.back();
+            if (prev < s && s < hi) splitters.push_back(s);
+        }
+    }
+    return splitters;
+}
+
 } // namespace s3q::detail
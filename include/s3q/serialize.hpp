@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+namespace s3q::detail {
+
+// Binary I/O of trivially copyable values and whole buffers of them. The
+// format is the in-memory representation, so it is not portable.
+
+template <class T>
+void writeValue(std::ostream &os, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <class T>
+bool readValue(std::istream &is, T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return bool(is.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+// Flags are written as single bytes, and anything but 0 or 1 is rejected
+inline void writeFlag(std::ostream &os, bool flag) {
+    writeValue(os, static_cast<std::uint8_t>(flag));
+}
+
+inline bool readFlag(std::istream &is, bool &flag) {
+    std::uint8_t byte;
+    if (!readValue(is, byte) || byte > 1) return false;
+    flag = (byte == 1);
+    return true;
+}
+
+template <class Buffer>
+void writeBuffer(std::ostream &os, const Buffer &buf) {
+    using Item = typename Buffer::value_type;
+    static_assert(std::is_trivially_copyable_v<Item>);
+
+    writeValue(os, static_cast<std::uint64_t>(buf.size()));
+    os.write(reinterpret_cast<const char *>(buf.data()),
+             static_cast<std::streamsize>(buf.size() * sizeof(Item)));
+}
+
+template <class Buffer>
+bool readBuffer(std::istream &is, Buffer &buf) {
+    using Item = typename Buffer::value_type;
+    static_assert(std::is_trivially_copyable_v<Item>);
+
+    std::uint64_t size;
+    if (!readValue(is, size)) return false;
+
+    // Read in chunks of at most 1 MiB, so a corrupt size fails on the first
+    // missing chunk instead of allocating all of its items up front
+    constexpr std::uint64_t kChunkSize =
+        std::max<std::uint64_t>(1, (1u << 20) / sizeof(Item));
+    buf.clear();
+    for (std::uint64_t done = 0; done < size;) {
+        const auto n = std::min(size - done, kChunkSize);
+        buf.resize(static_cast<std::size_t>(done + n));
+        if (!is.read(reinterpret_cast<char *>(buf.data() + done),
+                     static_cast<std::streamsize>(n * sizeof(Item)))) {
+            buf.clear();
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+} // namespace s3q::detail
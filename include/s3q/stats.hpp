@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace s3q {
+
+// Structural events of a single level
+struct LevelStats {
+    std::uint64_t classifier_builds = 0;
+    std::uint64_t splits = 0;
+    std::uint64_t joins = 0;   // buckets joined onto a neighbour
+    std::uint64_t retires = 0; // overflowing buckets retired into the max-buf
+    std::uint64_t refills = 0; // buckets stolen from the next level
+
+    // Buckets split off for the items of a single key
+    std::uint64_t equal_buckets = 0;
+
+    // Items written into buckets of this level by inserts, splits and joins
+    std::uint64_t items_moved = 0;
+
+    // Current capacity of all bucket buffers; not accumulated
+    std::uint64_t bytes_allocated = 0;
+
+    LevelStats &operator+=(const LevelStats &o) {
+        classifier_builds += o.classifier_builds;
+        splits += o.splits;
+        joins += o.joins;
+        retires += o.retires;
+        refills += o.refills;
+        equal_buckets += o.equal_buckets;
+        items_moved += o.items_moved;
+        bytes_allocated += o.bytes_allocated;
+        return *this;
+    }
+};
+
+/**
+ * Counters of a queue's structural events since its construction.
+ *
+ * Only collected for configs with `kCollectStats = true`. All counters are
+ * plain increments next to the events they count, so they cost next to
+ * nothing. Counts of levels that have been removed are kept.
+ */
+struct Stats {
+    std::uint64_t levels_added = 0;
+
+    // From finest to coarsest
+    std::vector<LevelStats> levels;
+};
+
+} // namespace s3q
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace s3q {
+
+/**
+ * A fixed set of threads that jointly execute one job at a time.
+ *
+ * Like ips4o's thread pools, a job is called as job(thread_idx, num_threads)
+ * on every thread, with the calling thread taking index 0. The call returns
+ * once all threads are done. Concurrent callers, e.g. queues sharing a pool,
+ * take turns. Jobs must not call the pool themselves.
+ *
+ * Provide `static ThreadPool *threadPool()` in your Cfg to let levels
+ * distribute large batches in parallel.
+ */
+class ThreadPool {
+public:
+    using Job = std::function<void(std::ptrdiff_t, std::ptrdiff_t)>;
+
+    explicit ThreadPool(
+        std::ptrdiff_t num_threads = std::thread::hardware_concurrency())
+        : num_threads_(std::max(std::ptrdiff_t{1}, num_threads)) {
+        for (std::ptrdiff_t i = 1; i < num_threads_; ++i) {
+            workers_.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        job_posted_.notify_all();
+        for (auto &worker : workers_) worker.join();
+    }
+
+    std::ptrdiff_t numThreads() const { return num_threads_; }
+
+    void operator()(const Job &job) {
+        std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            num_busy_ = num_threads_ - 1;
+            ++generation_;
+        }
+        job_posted_.notify_all();
+
+        job(0, num_threads_);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_done_.wait(lock, [this] { return num_busy_ == 0; });
+        job_ = nullptr;
+    }
+
+private:
+    void work(std::ptrdiff_t thread_idx) {
+        std::uint64_t seen = 0;
+        for (;;) {
+            const Job *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                job_posted_.wait(
+                    lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+                job = job_;
+            }
+
+            (*job)(thread_idx, num_threads_);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--num_busy_ == 0) job_done_.notify_one();
+        }
+    }
+
+    const std::ptrdiff_t num_threads_;
+    std::vector<std::thread> workers_;
+
+    // Held by the caller for the whole job
+    std::mutex submit_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable job_posted_, job_done_;
+    const Job *job_ = nullptr;
+    std::ptrdiff_t num_busy_ = 0;
+    std::uint64_t generation_ = 0;
+    bool stop_ = false;
+};
+
+} // namespace s3q
@@ -4,7 +4,9 @@
 #include <range/v3/core.hpp>
 
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <type_traits>
@@ -64,21 +66,55 @@ inline constexpr int log2_ceil(long n) {
 }
 
 /**
- * Provides information on the supremum and infimum of a given numeric type.
+ * Provides information on the supremum and infimum of a given numeric type
+ * in the order given by Compare, which must be constexpr and order numbers
+ * either ascending or descending.
  */
-template <typename T>
+template <typename T, class Compare = std::less<>>
 struct NumberRange {
     using limits = std::numeric_limits<T>;
 
+    // Whether Compare orders like std::less, as in a min-queue
+    static constexpr bool kAscending = Compare{}(T(0), T(1));
+
     static constexpr T inf() noexcept {
-        return limits::has_infinity ? -limits::infinity() : limits::lowest();
+        return kAscending ? lowest() : highest();
     }
 
     static constexpr T sup() noexcept {
-        return limits::has_infinity ? limits::infinity() : limits::max();
+        return kAscending ? highest() : lowest();
+    }
+
+    static bool contains(T k) {
+        return Compare{}(inf(), k) && Compare{}(k, sup());
+    };
+
+    // The value right before k in this order, for k > inf()
+    static T pred(T k) noexcept {
+        if constexpr (limits::is_integer) {
+            return static_cast<T>(kAscending ? k - 1 : k + 1);
+        } else {
+            return std::nextafter(k, inf());
+        }
+    }
+
+    // The value right after k in this order, for k < sup()
+    static T succ(T k) noexcept {
+        if constexpr (limits::is_integer) {
+            return static_cast<T>(kAscending ? k + 1 : k - 1);
+        } else {
+            return std::nextafter(k, sup());
+        }
+    }
+
+private:
+    static constexpr T lowest() noexcept {
+        return limits::has_infinity ? -limits::infinity() : limits::lowest();
     }
 
-    static bool contains(T k) { return inf() < k && k < sup(); };
+    static constexpr T highest() noexcept {
+        return limits::has_infinity ? limits::infinity() : limits::max();
+    }
 };
 
 template <class Rng1, class Rng2>
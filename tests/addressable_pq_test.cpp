@@ -0,0 +1,57 @@
+#include <s3q/s3q.hpp>
+
+#include <range/v3/algorithm/equal.hpp>
+#include <range/v3/core.hpp>
+#include <range/v3/view/generate_n.hpp>
+#include <range/v3/view/indices.hpp>
+#include <range/v3/view/transform.hpp>
+
+#include <tlx/die.hpp>
+
+#include <cstddef>
+#include <vector>
+
+struct TestCfg : s3q::DefaultCfg {
+    static constexpr std::ptrdiff_t kBufBaseSize = 64;
+    static constexpr int kLogMaxDegree = 4;
+};
+
+constexpr auto N = 1 << 10;
+constexpr s3q::detail::GetKey<TestCfg> getKey;
+constexpr auto makeItem(int i) { return TestCfg::Item{i, i}; }
+
+int main() {
+    using PQ = s3q::AddressablePriorityQueue<TestCfg>;
+    PQ pq;
+
+    namespace views = ranges::views;
+    auto keys = views::closed_indices(1, N);
+
+    // push items with keys shifted by N, so we can decrease them afterwards
+    std::vector<PQ::Handle> handles;
+    for (auto k : keys) {
+        handles.push_back(pq.push(makeItem(k + N)));
+    }
+
+    // erase every item with an odd key and decrease the remaining keys
+    std::vector<int> expected_keys;
+    for (auto k : keys) {
+        auto h = handles[std::size_t(k - 1)];
+        die_unless(getKey(pq.get(h)) == k + N);
+        if (k % 2) {
+            pq.erase(h);
+            die_unless(!pq.contains(h));
+        } else {
+            pq.decrease_key(h, k);
+            expected_keys.push_back(k);
+        }
+    }
+    die_unless(pq.size() == expected_keys.size());
+
+    auto popped_items = views::generate_n([&pq]() { return pq.pop(); }, N / 2);
+    auto popped_keys =
+        popped_items | views::transform(getKey) | ranges::to<std::vector>;
+
+    die_unless(pq.empty());
+    die_unless(ranges::equal(expected_keys, popped_keys));
+}
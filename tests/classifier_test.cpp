@@ -1,5 +1,6 @@
 #include <s3q/classifier.hpp>
 #include <s3q/config.hpp>
+#include <s3q/sampling.hpp>
 
 #include <range/v3/algorithm/all_of.hpp>
 #include <range/v3/core.hpp>
@@ -8,11 +9,19 @@
 #include <tlx/die.hpp>
 
 #include <array>
+#include <vector>
 
 struct TestCfg : s3q::detail::ExtendedCfg<> {
     static constexpr unsigned kLogMaxDegree = 2u;
 };
 
+struct RadixBase : s3q::DefaultCfg {
+    using Item = unsigned;
+    static constexpr bool kRadixSplitters = true;
+};
+
+using RadixCfg = s3q::detail::ExtendedCfg<RadixBase>;
+
 int main() {
     using ranges::views::ints;
     s3q::detail::Classifier<TestCfg> classifier;
@@ -46,4 +55,31 @@ int main() {
         });
         die_unless(ranges::all_of(counts, [](auto c) { return c == 3; }));
     }
+
+    { // radix splitters are the last keys of aligned cells
+        auto keys = std::vector<unsigned>{5, 9, 30};
+        auto splitters = s3q::detail::radixSplitters(keys, 4);
+        die_unless(splitters == std::vector<unsigned>({7, 15, 23}));
+    }
+
+    s3q::detail::Classifier<RadixCfg> radix_classifier;
+
+    { // classify by lookup table
+        int counts[4] = {0};
+        radix_classifier.build(std::array{7u, 11u, 15u});
+        radix_classifier.classify(ints(4u, 20u), [&counts](auto cls, auto it) {
+            die_unless(*it >= unsigned(cls + 1) * 4);
+            die_unless(*it < unsigned(cls + 2) * 4);
+            ++counts[cls];
+        });
+        die_unless(ranges::all_of(counts, [](auto c) { return c == 4; }));
+    }
+
+    { // fall back to the search tree if there are too many cells
+        radix_classifier.build(std::array{1u, 1000u});
+        die_unless(radix_classifier.classify(1u) == 0);
+        die_unless(radix_classifier.classify(2u) == 1);
+        die_unless(radix_classifier.classify(1000u) == 1);
+        die_unless(radix_classifier.classify(1001u) == 2);
+    }
 }
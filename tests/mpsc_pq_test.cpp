@@ -0,0 +1,66 @@
+#include <s3q/s3q.hpp>
+
+#include <range/v3/algorithm/equal.hpp>
+#include <range/v3/algorithm/sort.hpp>
+#include <range/v3/core.hpp>
+#include <range/v3/view/indices.hpp>
+
+#include <tlx/die.hpp>
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+struct TestCfg : s3q::DefaultCfg {
+    static constexpr std::ptrdiff_t kBufBaseSize = 64;
+    static constexpr int kLogMaxDegree = 4;
+};
+
+constexpr auto N = 1 << 12;
+constexpr auto kNumProducers = 4;
+constexpr s3q::detail::GetKey<TestCfg> getKey;
+constexpr auto makeItem(int i) { return TestCfg::Item{i, i}; }
+
+int main() {
+    namespace views = ranges::views;
+    using MPSC = s3q::MpscPriorityQueue<TestCfg>;
+
+    { // items are exactly ordered once all producers are done
+        MPSC pq;
+        {
+            auto producer = pq.producer();
+            for (auto k = N; k > 0; --k) producer.push(makeItem(k));
+        }
+        die_unless(pq.size() == std::size_t(N));
+
+        std::vector<int> keys;
+        for (TestCfg::Item item{}; pq.try_pop(item);) {
+            keys.push_back(getKey(item));
+        }
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, views::closed_indices(1, N)));
+    }
+
+    { // the consumer pops while producers push
+        MPSC pq;
+        std::vector<std::thread> producers;
+        for (int t = 0; t < kNumProducers; ++t) {
+            producers.emplace_back([&pq, t] {
+                auto producer = pq.producer();
+                for (auto k = 1 + t; k <= N; k += kNumProducers) {
+                    producer.push(makeItem(k));
+                }
+            });
+        }
+
+        std::vector<int> keys;
+        for (TestCfg::Item item{}; keys.size() < std::size_t(N);) {
+            if (pq.try_pop(item)) keys.push_back(getKey(item));
+        }
+        for (auto &producer : producers) producer.join();
+        die_unless(pq.empty());
+
+        ranges::sort(keys);
+        die_unless(ranges::equal(keys, views::closed_indices(1, N)));
+    }
+}
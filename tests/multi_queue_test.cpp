@@ -0,0 +1,79 @@
+#include <s3q/s3q.hpp>
+
+#include <range/v3/algorithm/equal.hpp>
+#include <range/v3/algorithm/sort.hpp>
+#include <range/v3/core.hpp>
+#include <range/v3/view/indices.hpp>
+#include <range/v3/view/reverse.hpp>
+
+#include <tlx/die.hpp>
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+struct TestCfg : s3q::DefaultCfg {
+    static constexpr std::ptrdiff_t kBufBaseSize = 64;
+    static constexpr int kLogMaxDegree = 4;
+};
+
+constexpr auto N = 1 << 12;
+constexpr auto kNumThreads = 4;
+constexpr s3q::detail::GetKey<TestCfg> getKey;
+constexpr auto makeItem(int i) { return TestCfg::Item{i, i}; }
+
+using MQ = s3q::MultiQueue<TestCfg>;
+
+template <class Fn>
+void runThreads(Fn &&fn) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t) threads.emplace_back(fn, t);
+    for (auto &thread : threads) thread.join();
+}
+
+int main() {
+    namespace views = ranges::views;
+
+    {
+        // with a single shard, the queue is exact
+        MQ mq(1, 1);
+        for (auto k : views::closed_indices(1, N) | views::reverse) {
+            mq.push(makeItem(k));
+        }
+        die_unless(mq.size() == std::size_t(N));
+
+        std::vector<int> keys;
+        for (TestCfg::Item item{}; mq.try_pop(item);) {
+            keys.push_back(getKey(item));
+        }
+        die_unless(mq.empty());
+        die_unless(ranges::equal(keys, views::closed_indices(1, N)));
+    }
+
+    {
+        // concurrent pushes and pops neither lose nor duplicate items
+        MQ mq(kNumThreads);
+        runThreads([&](int t) {
+            for (auto k = 1 + t; k <= N; k += kNumThreads) {
+                mq.push(makeItem(k));
+            }
+        });
+        die_unless(mq.size() == std::size_t(N));
+
+        std::vector<std::vector<int>> popped(kNumThreads);
+        runThreads([&](int t) {
+            auto &keys = popped[std::size_t(t)];
+            for (TestCfg::Item item{}; mq.try_pop(item);) {
+                keys.push_back(getKey(item));
+            }
+        });
+        die_unless(mq.empty());
+
+        std::vector<int> keys;
+        for (auto &thread_keys : popped) {
+            keys.insert(keys.end(), thread_keys.begin(), thread_keys.end());
+        }
+        ranges::sort(keys);
+        die_unless(ranges::equal(keys, views::closed_indices(1, N)));
+    }
+}
@@ -1,14 +1,27 @@
+#include <s3q/external.hpp>
 #include <s3q/s3q.hpp>
 
+#include <range/v3/algorithm/all_of.hpp>
 #include <range/v3/algorithm/equal.hpp>
+#include <range/v3/algorithm/is_sorted.hpp>
+#include <range/v3/algorithm/minmax.hpp>
 #include <range/v3/core.hpp>
 #include <range/v3/view/generate_n.hpp>
+#include <range/v3/view/drop.hpp>
 #include <range/v3/view/indices.hpp>
+#include <range/v3/view/reverse.hpp>
+#include <range/v3/view/take.hpp>
 #include <range/v3/view/transform.hpp>
 
 #include <tlx/die.hpp>
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <utility>
 #include <vector>
 
 struct TestCfg : s3q::DefaultCfg {
@@ -20,6 +33,69 @@ constexpr auto N = 1 << 10;
 constexpr s3q::detail::GetKey<TestCfg> getKey;
 constexpr auto makeItem(int i) { return TestCfg::Item{i, i}; }
 
+struct PoolCfg : TestCfg {
+    using Allocator = s3q::PoolAllocator<Item>;
+};
+
+struct ParallelCfg : TestCfg {
+    static constexpr std::ptrdiff_t kParallelThreshold = 32;
+
+    static s3q::ThreadPool *threadPool() {
+        static s3q::ThreadPool pool(4);
+        return &pool;
+    }
+};
+
+struct ExternalCfg : TestCfg {
+    static constexpr int kExternalLevel = 1;
+    static const char *externalDirectory() { return "/tmp"; }
+};
+
+struct OctaryCfg : TestCfg {
+    static constexpr int kMinBufArity = 8;
+};
+
+struct RadixCfg : TestCfg {
+    struct Item {
+        unsigned key, value;
+    };
+    static constexpr bool kRadixSplitters = true;
+};
+
+struct MonotoneCfg : TestCfg {
+    static constexpr bool kMonotone = true;
+};
+
+struct StatsCfg : TestCfg {
+    static constexpr bool kCollectStats = true;
+};
+
+struct MonotoneStatsCfg : MonotoneCfg {
+    static constexpr bool kCollectStats = true;
+};
+
+struct MaxCfg : TestCfg {
+    struct Item {
+        unsigned key, value;
+    };
+    using Compare = std::greater<>;
+};
+
+template <class PQ>
+auto popAllKeys(PQ &pq) {
+    auto popped_items =
+        ranges::views::generate_n([&pq]() { return pq.pop(); }, N);
+    return popped_items | ranges::views::transform(getKey) |
+           ranges::to<std::vector>;
+}
+
+template <class PQ>
+auto popAllItems(PQ &pq) {
+    auto popped_items =
+        ranges::views::generate_n([&pq]() { return pq.pop(); }, N);
+    return popped_items | ranges::to<std::vector>;
+}
+
 int main() {
     s3q::PriorityQueue<TestCfg> pq;
 
@@ -37,4 +113,336 @@ int main() {
 
     die_unless(pq.empty());
     die_unless(ranges::equal(keys, popped_keys));
+
+    { // push items in batches of different sizes and descending order
+        s3q::PriorityQueue<TestCfg> pq;
+
+        auto rev_items = items | views::reverse | ranges::to<std::vector>;
+        pq.push_range(rev_items | views::take(3));
+        pq.push_range(rev_items | views::drop(3) | views::take(200));
+        pq.push_range(rev_items | views::drop(203));
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_keys));
+    }
+
+    { // push ranges that mostly end up in the max-buffer
+        s3q::PriorityQueue<TestCfg> pq;
+
+        pq.push_range(items | views::take(100));
+        pq.push_range(items | views::drop(100));
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_keys));
+    }
+
+    { // pop items in batches
+        s3q::PriorityQueue<TestCfg> pq;
+        pq.push_range(items);
+
+        std::vector<TestCfg::Item> popped;
+        auto out = std::back_inserter(popped);
+        out = pq.pop_n(1, out);
+        out = pq.pop_n(100, out);
+        out = pq.pop_until(500, out);
+        die_unless(popped.size() == 500);
+        out = pq.pop_n(pq.size(), out);
+
+        auto popped_keys = popped | views::transform(getKey);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_keys));
+    }
+
+    { // pop whole buckets
+        s3q::PriorityQueue<TestCfg> pq;
+        pq.push_range(items);
+
+        std::size_t num_popped = 0;
+        while (!pq.empty()) {
+            auto bucket = pq.pop_bucket();
+            auto bucket_keys = bucket.buf | views::transform(getKey);
+            auto [kmin, kmax] = ranges::minmax(bucket_keys);
+            die_unless(kmin == int(num_popped) + 1);
+            die_unless(kmax <= bucket.sup);
+            die_unless(pq.empty() || bucket.sup < getKey(pq.top()));
+            num_popped += bucket.buf.size();
+        }
+        die_unless(num_popped == std::size_t(N));
+    }
+
+    { // build from range
+        s3q::PriorityQueue<TestCfg> pq;
+        pq.assign(items | views::reverse);
+        die_unless(pq.size() == std::size_t(N));
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_keys));
+    }
+
+    { // merge two queues with interleaved keys
+        s3q::PriorityQueue<TestCfg> pq, other;
+        for (auto i : items) {
+            (getKey(i) % 2 ? pq : other).push(i);
+        }
+
+        pq.merge(std::move(other));
+        die_unless(other.empty());
+        die_unless(pq.size() == std::size_t(N));
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_keys));
+    }
+
+    { // use pooled buffers
+        s3q::PriorityQueue<PoolCfg> pq;
+
+        for (auto i : items | views::reverse) {
+            pq.push(i);
+        }
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_keys));
+    }
+
+    { // distribute large batches in parallel
+        s3q::PriorityQueue<ParallelCfg> pq;
+
+        for (auto i : items) {
+            pq.push(i);
+        }
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_keys));
+    }
+
+    { // store coarse levels in memory-mapped files
+        auto &stats = s3q::detail::MappedStorage::stats();
+        const auto buffer_bytes = stats.buffer_bytes.load();
+        {
+            s3q::PriorityQueue<ExternalCfg> pq;
+
+            for (auto i : items) {
+                pq.push(i);
+            }
+            die_unless(stats.buffer_bytes > buffer_bytes);
+
+            auto popped_keys = popAllKeys(pq);
+            die_unless(pq.empty());
+            die_unless(ranges::equal(keys, popped_keys));
+        }
+        // Only the mappings kept for reuse outlive the queue
+        using Storage = s3q::detail::MappedStorage;
+        die_unless(stats.address_space_mapped - stats.address_space_unmapped <=
+                   Storage::kMaxFreeMappings * Storage::kMinMappingSize);
+    }
+
+    { // save a queue and load it into another one
+        s3q::PriorityQueue<TestCfg> pq, restored;
+
+        for (auto i : items | views::reverse) {
+            pq.push(i);
+        }
+        auto popped = pq.pop();
+
+        std::stringstream stream;
+        pq.save(stream);
+        restored.load(stream);
+        die_unless(stream);
+        die_unless(restored.size() == pq.size());
+        die_unless(getKey(restored.top()) == getKey(popped) + 1);
+
+        auto popped_keys = views::generate_n(
+            [&restored]() { return getKey(restored.pop()); }, N - 1);
+        die_unless(ranges::equal(keys | views::drop(1), popped_keys));
+        die_unless(restored.empty());
+
+        // malformed input leaves the queue empty
+        std::stringstream garbage("garbage");
+        restored.load(garbage);
+        die_unless(!garbage);
+        die_unless(restored.empty());
+
+        // so do truncated snapshots
+        std::stringstream snapshot;
+        pq.save(snapshot);
+        const auto bytes = snapshot.str();
+        std::stringstream truncated(bytes.substr(0, bytes.size() / 2));
+        restored.load(truncated);
+        die_unless(!truncated);
+        die_unless(restored.empty());
+    }
+
+    { // use an 8-ary heap for the min-buffer
+        s3q::PriorityQueue<OctaryCfg> pq;
+
+        for (auto i : items | views::reverse) {
+            pq.push(i);
+        }
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_keys));
+    }
+
+    { // keep payloads out of the buckets
+        s3q::IndirectPriorityQueue<TestCfg> pq;
+
+        auto rev_items = items | views::reverse | ranges::to<std::vector>;
+        pq.push_range(rev_items | views::take(N / 2));
+        for (auto i : rev_items | views::drop(N / 2)) {
+            pq.push(i);
+        }
+
+        auto popped_items = popAllItems(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys, popped_items, {}, {}, getKey));
+        die_unless(ranges::all_of(popped_items, [](auto item) {
+            return item.key == item.value;
+        }));
+    }
+
+    { // split buckets into bit ranges of integer keys
+        s3q::PriorityQueue<RadixCfg> pq;
+
+        // spread keys, so that splits need a variety of shifts
+        auto spread = [](int i) { return unsigned(i) * 4099u; };
+        for (auto i : keys | views::reverse) {
+            pq.push({spread(i), unsigned(i)});
+        }
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(keys | views::transform(spread), popped_keys));
+    }
+
+    { // never push keys below the last popped key
+        s3q::PriorityQueue<MonotoneCfg> pq;
+        for (auto i : items) {
+            pq.push(i);
+        }
+
+        // hold model: every pop schedules a new item a little later
+        int last_key = 0;
+        for (auto i : keys) {
+            const auto key = getKey(pq.pop());
+            die_unless(key >= last_key);
+            last_key = key;
+            pq.push(makeItem(last_key + i % 97 * 37));
+        }
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(popped_keys.front() >= last_key);
+        die_unless(ranges::is_sorted(popped_keys));
+    }
+
+    { // never mistake skewed keys for duplicates
+        s3q::PriorityQueue<MonotoneStatsCfg> pq;
+
+        // a few huge keys make even splitters useless for all others
+        auto skewed = [](int i) { return i % 32 == 0 ? (1 << 24) + i : i; };
+        for (auto i : keys) {
+            pq.push(makeItem(skewed(i)));
+        }
+        for (auto i : keys) {
+            pq.push(makeItem(getKey(pq.pop()) + i % 7 * N + 1));
+        }
+
+        auto popped_keys = popAllKeys(pq);
+        die_unless(pq.empty());
+        die_unless(ranges::is_sorted(popped_keys));
+        for (const auto &lvl : pq.stats().levels) {
+            die_unless(lvl.equal_buckets == 0);
+        }
+    }
+
+    { // pop the largest unsigned keys first, without negating them
+        s3q::PriorityQueue<MaxCfg> pq;
+
+        auto max_item = [](int i) { return MaxCfg::Item{unsigned(i), 0u}; };
+        auto max_items =
+            keys | views::transform(max_item) | ranges::to<std::vector>;
+        pq.push_range(max_items | views::take(N / 2));
+        for (auto item : max_items | views::drop(N / 2)) {
+            pq.push(item);
+        }
+
+        std::vector<MaxCfg::Item> popped;
+        auto out = std::back_inserter(popped);
+        out = pq.pop_until(unsigned(N / 2 + 1), out);
+        die_unless(popped.size() == N / 2);
+        out = pq.pop_n(pq.size(), out);
+
+        auto as_unsigned = [](int i) { return unsigned(i); };
+        auto popped_keys = popped | views::transform(getKey);
+        die_unless(pq.empty());
+        die_unless(ranges::equal(
+            keys | views::reverse | views::transform(as_unsigned),
+            popped_keys));
+    }
+
+    { // count structural events
+        s3q::PriorityQueue<StatsCfg> pq;
+        die_unless(pq.stats().levels_added == 0);
+
+        for (auto i : items | views::reverse) {
+            pq.push(i);
+        }
+
+        const auto stats = pq.stats();
+        die_unless(stats.levels_added > 0);
+        die_unless(stats.levels.size() == stats.levels_added + 1);
+
+        const auto &first = stats.levels.front();
+        die_unless(first.splits > 0);
+        die_unless(first.classifier_builds >= first.splits);
+        die_unless(first.items_moved >= N / 2u);
+        die_unless(first.bytes_allocated > 0);
+
+        // popping refills finer levels and removes coarser ones
+        popAllKeys(pq);
+        const auto drained = pq.stats();
+        die_unless(drained.levels.size() == stats.levels.size());
+        die_unless(drained.levels.front().refills > 0);
+        die_unless(drained.levels.front().splits >= first.splits);
+    }
+
+    { // split off equality buckets for heavily duplicated keys
+        s3q::PriorityQueue<StatsCfg> pq;
+        std::multiset<int> expected;
+        auto push = [&](int key) {
+            pq.push(makeItem(key));
+            expected.insert(key);
+        };
+        auto pop_and_check = [&] {
+            die_unless(getKey(pq.pop()) == *expected.begin());
+            expected.erase(expected.begin());
+        };
+
+        // most items share one of two keys, a few are spread around them
+        for (auto i : keys) {
+            push(i % 16 == 0 ? i : 300 + i % 2 * 400);
+        }
+
+        // push keys equal to and less than the one that is popped next
+        for (auto i : keys | views::take(N / 4)) {
+            pop_and_check();
+            push(i % 2 == 0 ? 300 : 299 - i % 7);
+        }
+
+        while (!pq.empty()) pop_and_check();
+        die_unless(expected.empty());
+
+        std::uint64_t equal_buckets = 0;
+        for (const auto &lvl : pq.stats().levels) {
+            equal_buckets += lvl.equal_buckets;
+        }
+        die_unless(equal_buckets > 0);
+    }
 }